@@ -0,0 +1,149 @@
+// Compare the compile-time CSG kernels (csg.hpp) with the bytecode interpreter
+// (csg_program.hpp) and an equivalent tree of virtual nodes evaluated point by point, on a
+// scene of smooth-blended spheres and boxes.
+
+#include <algorithm>
+#include <chrono>
+#include <iostream>
+#include <memory>
+#include <vector>
+
+#include <glm/glm.hpp>
+
+#include "csg.hpp"
+#include "csg_program.hpp"
+
+// ************************************ //
+//          Virtual-call tree
+// ************************************ //
+struct Node {
+    virtual ~Node() = default;
+    virtual float evaluate(glm::vec3 p) const = 0;
+};
+
+struct SphereNode : Node {
+    csg::Sphere sphere;
+    SphereNode(csg::Sphere sphere) : sphere(sphere) {}
+    float evaluate(glm::vec3 p) const override { return sphere(p.x, p.y, p.z); }
+};
+
+struct BoxNode : Node {
+    csg::Box box;
+    BoxNode(csg::Box box) : box(box) {}
+    float evaluate(glm::vec3 p) const override { return box(p.x, p.y, p.z); }
+};
+
+struct UnionNode : Node {
+    std::unique_ptr<Node> left, right;
+    UnionNode(std::unique_ptr<Node> left, std::unique_ptr<Node> right)
+        : left(std::move(left)), right(std::move(right)) {}
+    float evaluate(glm::vec3 p) const override {
+        return std::min(left->evaluate(p), right->evaluate(p));
+    }
+};
+
+struct SmoothUnionNode : Node {
+    std::unique_ptr<Node> left, right;
+    float k;
+    SmoothUnionNode(std::unique_ptr<Node> left, std::unique_ptr<Node> right, float k)
+        : left(std::move(left)), right(std::move(right)), k(k) {}
+    float evaluate(glm::vec3 p) const override {
+        float a = left->evaluate(p);
+        float b = right->evaluate(p);
+        float h = std::max(k - std::abs(a - b), 0.0f) * (1.0f / k);
+        return std::min(a, b) - h * h * (0.25f * k);
+    }
+};
+
+// ************************************ //
+//          Scene
+// ************************************ //
+static const float blend = 0.05f;
+
+static csg::Sphere sphere_at(int i) {
+    return csg::sphere(glm::vec3(0.25f * (i % 4) - 0.4f, 0.25f * (i / 4) - 0.4f, 0.0f), 0.1f);
+}
+
+static csg::Box box_at(int i) {
+    return csg::box(glm::vec3(0.25f * (i % 4) - 0.35f, 0.25f * (i / 4) - 0.35f, 0.05f),
+                    glm::vec3(0.06f));
+}
+
+static auto pair_at(int i) { return csg::smooth_unite(sphere_at(i), box_at(i), blend); }
+
+static std::unique_ptr<Node> virtual_pair_at(int i) {
+    return std::make_unique<SmoothUnionNode>(std::make_unique<SphereNode>(sphere_at(i)),
+                                             std::make_unique<BoxNode>(box_at(i)), blend);
+}
+
+int main() {
+    // 8 blended sphere/box pairs, 16 primitives in total
+    auto scene = csg::unite(pair_at(0), pair_at(1), pair_at(2), pair_at(3), pair_at(4),
+                            pair_at(5), pair_at(6), pair_at(7));
+    std::unique_ptr<Node> tree = virtual_pair_at(0);
+    for (int i = 1; i < 8; ++i) {
+        tree = std::make_unique<UnionNode>(std::move(tree), virtual_pair_at(i));
+    }
+    auto field = csg::make_field(scene);
+
+    CsgProgram program;
+    for (int i = 0; i < 8; ++i) {
+        auto sphere = sphere_at(i);
+        auto box = box_at(i);
+        program.sphere(sphere.center, sphere.radius);
+        program.box(box.center, box.half_size);
+        program.smooth_unite(blend);
+        if (i > 0) {
+            program.unite();
+        }
+    }
+    ProgramField program_field(program);
+
+    const int resolution = 128;
+    const size_t count = static_cast<size_t>(resolution) * resolution * resolution;
+    std::vector<float> x(count), y(count), z(count);
+    for (size_t i = 0; i < count; ++i) {
+        x[i] = (i % resolution) / float(resolution) - 0.5f;
+        y[i] = (i / resolution % resolution) / float(resolution) - 0.5f;
+        z[i] = (i / resolution / resolution) / float(resolution) - 0.5f;
+    }
+    std::vector<float> fused(count), scalar(count), interpreted(count), virtual_calls(count);
+
+    auto time = [](auto &&run) {
+        auto start = std::chrono::steady_clock::now();
+        run();
+        return std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+    };
+
+    double fused_time =
+        time([&]() { field->evaluate({x.data(), y.data(), z.data(), count}, fused.data()); });
+    double scalar_time = time([&]() {
+        for (size_t i = 0; i < count; ++i) {
+            scalar[i] = scene(x[i], y[i], z[i]);
+        }
+    });
+    double interpreter_time = time([&]() {
+        program_field.evaluate({x.data(), y.data(), z.data(), count}, interpreted.data());
+    });
+    double virtual_time = time([&]() {
+        for (size_t i = 0; i < count; ++i) {
+            virtual_calls[i] = tree->evaluate(glm::vec3(x[i], y[i], z[i]));
+        }
+    });
+
+    float max_difference = 0.0f;
+    for (size_t i = 0; i < count; ++i) {
+        max_difference = std::max(max_difference, std::abs(fused[i] - virtual_calls[i]));
+        max_difference = std::max(max_difference, std::abs(fused[i] - interpreted[i]));
+    }
+
+    std::cout << count << " points, 16 primitives, FloatBatch width " << FloatBatch::width
+              << '\n';
+    std::cout << "fused SIMD kernel  : " << 1e9 * fused_time / count << " ns/point\n";
+    std::cout << "fused scalar kernel: " << 1e9 * scalar_time / count << " ns/point\n";
+    std::cout << "bytecode VM        : " << 1e9 * interpreter_time / count << " ns/point ("
+              << interpreter_time / fused_time << "x the fused SIMD kernel)\n";
+    std::cout << "virtual-call tree  : " << 1e9 * virtual_time / count << " ns/point ("
+              << virtual_time / fused_time << "x the fused SIMD kernel)\n";
+    std::cout << "max difference     : " << max_difference << '\n';
+}
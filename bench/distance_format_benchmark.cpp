@@ -0,0 +1,169 @@
+// Frame time and texture memory of each distance texture format (see distance_encoding.hpp)
+// from 16^3 to 512^3 texels. The scene, the default sphere or the given scene file, is placed
+// and drawn as in the viewer, with the viewer shaders, into a hidden 800x600 window. Run it
+// from the repository root so that the shaders are found. The normal format (see
+// normal_encoding.hpp) trades the memory of the normal texture against the fetches of the
+// normals derived from the distances. With r8 distances and rgb8 normals, the interleaved
+// layout is measured against the split one; scenes such as scenes/blend.csg, whose rays take
+// many steps, show the difference best.
+//
+// Usage: distance-format-benchmark [scene] [encoding] [normal format]
+
+#include <chrono>
+#include <cstdlib>
+#include <iomanip>
+#include <iostream>
+#include <memory>
+#include <string>
+#include <utility>
+#include <vector>
+
+#include "block.hpp"
+#include "opengl_helper.hpp"
+#include "scene.hpp"
+#include "window_helper.hpp"
+
+static const int width = 800;
+static const int height = 600;
+
+// Draw one frame with the uniforms of the viewer
+static void draw_frame(GLuint program, GLuint vao, const Block &block, glm::vec3 block_origin,
+                       float block_size, int nb_texels) {
+    auto projection = glm::perspective(glm::radians(45.0f), 800.0f / 600.0f, 0.1f, 100.0f);
+    auto projection_inverse = glm::inverse(projection);
+    glm::vec3 camera_center = {0.0f, 0.0f, 1.0f};
+    glm::vec3 light_pos = {10.0f * std::sin(5.2f), 0.0f, 10.0f * std::cos(5.2f)};
+
+    glClear(GL_COLOR_BUFFER_BIT);
+    glUseProgram(program);
+    glBindVertexArray(vao);
+    glUniformMatrix4fv(glGetUniformLocation(program, "projection"), 1, GL_FALSE,
+                       &projection[0][0]);
+    glUniformMatrix4fv(glGetUniformLocation(program, "projection_inverse"), 1, GL_FALSE,
+                       &projection_inverse[0][0]);
+    glUniform1f(glGetUniformLocation(program, "max_depth"), 100.0f);
+    glUniform1i(glGetUniformLocation(program, "width"), width);
+    glUniform1i(glGetUniformLocation(program, "height"), height);
+    glUniform3fv(glGetUniformLocation(program, "camera_center"), 1, &camera_center[0]);
+    glUniform3fv(glGetUniformLocation(program, "light_pos"), 1, &light_pos[0]);
+    glUniform1i(glGetUniformLocation(program, "sdf_texture"), 0);
+    glUniform1i(glGetUniformLocation(program, "normals_texture"), 1);
+    block.bind_textures();
+    glUniform3fv(glGetUniformLocation(program, "volume_origin"), 1, &block_origin[0]);
+    glUniform1f(glGetUniformLocation(program, "volume_size"), block_size);
+    glUniform1f(glGetUniformLocation(program, "nb_texels"), nb_texels);
+    block.set_distance_uniforms(program);
+    block.set_normal_uniforms(program);
+    glDrawElements(GL_TRIANGLES, 6, GL_UNSIGNED_INT, nullptr);
+    glBindVertexArray(0);
+    glUseProgram(0);
+}
+
+// Full screen quad of the viewer
+static GLuint create_quad() {
+    const float vertices[] = {-1.0f, -1.0f, 0.0f, -1.0f, 1.0f, 0.0f,
+                              1.0f,  -1.0f, 0.0f, 1.0f,  1.0f, 0.0f};
+    const unsigned int indices[] = {0, 1, 2, 1, 3, 2};
+    GLuint vao = 0, vbo = 0, ebo = 0;
+    glGenVertexArrays(1, &vao);
+    glGenBuffers(1, &vbo);
+    glGenBuffers(1, &ebo);
+    glBindVertexArray(vao);
+    glBindBuffer(GL_ARRAY_BUFFER, vbo);
+    glBufferData(GL_ARRAY_BUFFER, sizeof(vertices), vertices, GL_STATIC_DRAW);
+    glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, ebo);
+    glBufferData(GL_ELEMENT_ARRAY_BUFFER, sizeof(indices), indices, GL_STATIC_DRAW);
+    glEnableVertexAttribArray(0);
+    glVertexAttribPointer(0, 3, GL_FLOAT, GL_FALSE, 3 * sizeof(float), nullptr);
+    glBindVertexArray(0);
+    return vao;
+}
+
+int main(int argc, char **argv) {
+    auto mode = EncodingMode::fixed;
+    if (argc > 2 && !parse_encoding_mode(argv[2], mode)) {
+        std::cerr << "Error: unknown encoding " << argv[2]
+                  << ", expected fixed, voxel_band, block_range or companded" << std::endl;
+        return EXIT_FAILURE;
+    }
+    auto normal_format = NormalFormat::rgb8;
+    if (argc > 3 && !parse_normal_format(argv[3], normal_format)) {
+        std::cerr << "Error: unknown normal format " << argv[3]
+                  << ", expected rgb8, oct_rg8, oct_rg16 or none" << std::endl;
+        return EXIT_FAILURE;
+    }
+
+    glfw_init();
+    glfwWindowHint(GLFW_VISIBLE, GLFW_FALSE);
+    auto window = glfw_create_window(width, height, "distance-format-benchmark");
+    glfwMakeContextCurrent(window);
+    glad_init();
+    glfwSwapInterval(0);
+    std::cout << "Renderer: " << glGetString(GL_RENDERER) << "\n\n";
+    GLuint program =
+        create_shader_program("shaders/vertex_shader.glsl", "shaders/fragment_shader.glsl");
+    GLuint vao = create_quad();
+    glEnable(GL_CULL_FACE);
+    glCullFace(GL_FRONT);
+
+    auto sphere_position = glm::vec3(0.0f, 0.0f, -2.0f);
+    auto block_origin = glm::vec3(-0.5f) + sphere_position;
+    float block_size = 1.0f;
+    std::shared_ptr<const SdfField> field = std::make_shared<SphereField>(sphere_position, 0.2f);
+    if (argc > 1) {
+        field = load_scene(argv[1], block_origin, block_size, false);
+    }
+
+    const int nb_frames = 50;
+    std::cout << std::setw(8) << "texels" << std::setw(8) << "format" << std::setw(13)
+              << "layout" << std::setw(14) << "distance MB" << std::setw(11) << "total MB"
+              << std::setw(11) << "frame ms" << '\n';
+    for (int nb_texels : {16, 32, 64, 128, 256, 512}) {
+        std::vector<std::pair<DistanceFormat, TexelLayout>> variants = {
+            {DistanceFormat::r8, TexelLayout::split},
+            {DistanceFormat::r16, TexelLayout::split},
+            {DistanceFormat::r16f, TexelLayout::split},
+            {DistanceFormat::r32f, TexelLayout::split}};
+        if (normal_format == NormalFormat::rgb8) {
+            variants.insert(variants.begin() + 1, {DistanceFormat::r8, TexelLayout::interleaved});
+        }
+        for (auto [format, layout] : variants) {
+            Block block(block_origin, block_size, nb_texels, field);
+            block.set_encoding_mode(mode);
+            block.set_distance_format(format);
+            block.set_normal_format(normal_format);
+            block.set_texel_layout(layout);
+            block.generate_textures();
+
+            // The first frame also uploads the textures to the GPU
+            draw_frame(program, vao, block, block_origin, block_size, nb_texels);
+            glFinish();
+            auto start = std::chrono::steady_clock::now();
+            for (int frame = 0; frame < nb_frames; ++frame) {
+                draw_frame(program, vao, block, block_origin, block_size, nb_texels);
+            }
+            glFinish();
+            std::chrono::duration<double> duration = std::chrono::steady_clock::now() - start;
+
+            // Drivers usually pad the RGB8 normals to 4 bytes
+            double nb_total = static_cast<double>(nb_texels) * nb_texels * nb_texels;
+            size_t normal_bytes = normal_format == NormalFormat::rgb8
+                                      ? 4
+                                      : normal_texel_bytes(normal_format);
+            double distance_megabytes = distance_texel_bytes(format) * nb_total / 1024 / 1024;
+            double total_megabytes = distance_megabytes + normal_bytes * nb_total / 1024 / 1024;
+            if (layout == TexelLayout::interleaved) {
+                // A single RGBA8 texture holds both
+                distance_megabytes = total_megabytes;
+            }
+            std::cout << std::setw(8) << nb_texels << std::setw(8) << distance_format_name(format)
+                      << std::setw(13) << texel_layout_name(layout) << std::fixed
+                      << std::setprecision(3) << std::setw(14)
+                      << distance_megabytes << std::setw(11) << total_megabytes << std::setw(11)
+                      << 1000.0 * duration.count() / nb_frames << std::defaultfloat << '\n';
+        }
+    }
+
+    glfwDestroyWindow(window);
+    glfwTerminate();
+}
@@ -0,0 +1,92 @@
+// Compare the compute-shader bake (gpu_baker.hpp) with the CPU baker of Block on random brush
+// scenes. Needs an OpenGL 4.3 context; with Mesa, LIBGL_ALWAYS_SOFTWARE=1 runs it on llvmpipe.
+
+#include <chrono>
+#include <cstdlib>
+#include <iomanip>
+#include <iostream>
+#include <memory>
+#include <random>
+#include <vector>
+
+#include "block.hpp"
+#include "brush_field.hpp"
+#include "gl_compute.hpp"
+#include "window_helper.hpp"
+
+// Scattered brushes in a cube of side 16 centered on the origin
+static std::shared_ptr<BrushField> random_scene(int nb_brushes, float blend) {
+    std::mt19937 generator(1);
+    std::uniform_real_distribution<float> position(-6.0f, 6.0f), size(0.5f, 2.0f);
+    std::vector<Brush> brushes;
+    for (int i = 0; i < nb_brushes; ++i) {
+        glm::vec3 center(position(generator), position(generator), position(generator));
+        glm::vec3 brush_size(size(generator), 0.3f * size(generator), size(generator));
+        brushes.push_back({static_cast<BrushShape>(i % 3), center, brush_size});
+    }
+    return std::make_shared<BrushField>(std::move(brushes), blend);
+}
+
+// Seconds taken by bake, waiting for the GPU to finish
+template <typename Function> static double time_bake(Function bake) {
+    auto start = std::chrono::steady_clock::now();
+    bake();
+    glFinish();
+    std::chrono::duration<double> duration = std::chrono::steady_clock::now() - start;
+    return duration.count();
+}
+
+int main() {
+    glfw_init();
+    glfwWindowHint(GLFW_VISIBLE, GLFW_FALSE);
+    auto window = glfw_create_window(64, 64, "gpu-bake-benchmark", 4, 3);
+    glfwMakeContextCurrent(window);
+    glad_init();
+    if (!load_compute_functions(reinterpret_cast<GLADloadproc>(glfwGetProcAddress))) {
+        std::cerr << "Error: the context does not support OpenGL 4.3 compute shaders" << std::endl;
+        return EXIT_FAILURE;
+    }
+    std::cout << "Renderer: " << glGetString(GL_RENDERER) << "\n\n";
+
+    std::cout << std::setw(8) << "texels" << std::setw(9) << "brushes" << std::setw(7) << "blend"
+              << std::setw(10) << "CPU (s)" << std::setw(10) << "GPU (s)" << std::setw(12)
+              << "GPU Mtex/s" << std::setw(12) << "code diffs" << '\n';
+    for (int nb_texels : {64, 128, 256}) {
+        for (int nb_brushes : {20, 200}) {
+            for (float blend : {0.0f, 0.5f}) {
+                auto scene = random_scene(nb_brushes, blend);
+                Block cpu_block(glm::vec3(-8.0f), 16.0f, nb_texels, scene);
+                Block gpu_block(glm::vec3(-8.0f), 16.0f, nb_texels, scene);
+                double cpu_time = time_bake([&] { cpu_block.generate_textures(); });
+                // The first GPU bake also compiles the shader
+                gpu_block.generate_textures_gpu();
+                glFinish();
+                double gpu_time = time_bake([&] { gpu_block.generate_textures_gpu(); });
+
+                // Read the GPU distances back and compare them with the CPU codes
+                size_t nb_total = static_cast<size_t>(nb_texels) * nb_texels * nb_texels;
+                std::vector<GLubyte> cpu_codes(nb_total), gpu_codes(nb_total);
+                glPixelStorei(GL_PACK_ALIGNMENT, 1);
+                cpu_block.bind_textures();
+                glActiveTexture(GL_TEXTURE0);
+                glGetTexImage(GL_TEXTURE_3D, 0, GL_RED, GL_UNSIGNED_BYTE, cpu_codes.data());
+                gpu_block.bind_textures();
+                glActiveTexture(GL_TEXTURE0);
+                glGetTexImage(GL_TEXTURE_3D, 0, GL_RED, GL_UNSIGNED_BYTE, gpu_codes.data());
+                size_t nb_differences = 0;
+                for (size_t i = 0; i < nb_total; ++i) {
+                    nb_differences += cpu_codes[i] != gpu_codes[i];
+                }
+
+                std::cout << std::setw(8) << nb_texels << std::setw(9) << nb_brushes
+                          << std::setw(7) << blend << std::setw(10) << std::fixed
+                          << std::setprecision(4) << cpu_time << std::setw(10) << gpu_time
+                          << std::setw(12) << std::setprecision(1) << nb_total / gpu_time * 1e-6
+                          << std::setw(12) << nb_differences << std::defaultfloat << '\n';
+            }
+        }
+    }
+
+    glfwDestroyWindow(window);
+    glfwTerminate();
+}
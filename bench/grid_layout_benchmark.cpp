@@ -0,0 +1,130 @@
+// Cost of the CPU passes over a DistanceGrid in the linear and bricked layouts (see
+// distance_grid.hpp): sampling a field, redistancing it, and trilinear reads through a
+// GridField at scattered probes and along random rays, as sphere tracing reads them. The field
+// is a smooth blend of two spheres, which is not a distance and gives redistance some work.
+// The signed distance transform of the same shape as a 512^3 occupancy volume, the input of
+// .raw scenes, is timed last.
+
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <cstdint>
+#include <cstdlib>
+#include <iomanip>
+#include <iostream>
+#include <memory>
+#include <random>
+#include <vector>
+
+#include <glm/glm.hpp>
+
+#include "distance_grid.hpp"
+#include "distance_transform.hpp"
+#include "redistance.hpp"
+
+static float blended_spheres(glm::vec3 p) {
+    float a = glm::length(p - glm::vec3(-0.15f, 0.0f, 0.0f)) - 0.2f;
+    float b = glm::length(p - glm::vec3(0.15f, 0.05f, 0.0f)) - 0.2f;
+    float k = 0.2f;
+    float h = glm::clamp(0.5f + 0.5f * (b - a) / k, 0.0f, 1.0f);
+    return glm::mix(b, a, h) - k * h * (1.0f - h);
+}
+
+int main() {
+    // Best of three runs
+    auto time = [](auto &&run) {
+        double best = 0.0;
+        for (int i = 0; i < 3; ++i) {
+            auto start = std::chrono::steady_clock::now();
+            run();
+            double duration =
+                std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+            best = i == 0 ? duration : std::min(best, duration);
+        }
+        return best;
+    };
+
+    // Scattered probes, and steps of 1/4 voxel along random rays through the block
+    const size_t nb_probes = 1 << 22;
+    const int nb_rays = 1 << 14;
+    std::vector<float> probe_x(nb_probes), probe_y(nb_probes), probe_z(nb_probes);
+    std::mt19937 generator(1);
+    std::uniform_real_distribution<float> coordinate(-0.5f, 0.5f);
+    for (size_t i = 0; i < nb_probes; ++i) {
+        probe_x[i] = coordinate(generator);
+        probe_y[i] = coordinate(generator);
+        probe_z[i] = coordinate(generator);
+    }
+
+    FunctionField field(blended_spheres);
+    std::cout << std::setw(8) << "texels" << std::setw(9) << "layout" << std::setw(11)
+              << "sample ms" << std::setw(15) << "redistance ms" << std::setw(12) << "probes ns"
+              << std::setw(10) << "rays ns" << '\n';
+    for (int nb_texels : {64, 128, 256}) {
+        std::vector<float> ray_x, ray_y, ray_z;
+        int nb_steps = 4 * nb_texels;
+        for (int ray = 0; ray < nb_rays; ++ray) {
+            glm::vec3 start(coordinate(generator), coordinate(generator), -0.5f);
+            glm::vec3 end(coordinate(generator), coordinate(generator), 0.5f);
+            for (int step = 0; step < nb_steps; ++step) {
+                auto position = glm::mix(start, end, static_cast<float>(step) / nb_steps);
+                ray_x.push_back(position.x);
+                ray_y.push_back(position.y);
+                ray_z.push_back(position.z);
+            }
+        }
+        std::vector<float> distances(std::max(nb_probes, ray_x.size()));
+
+        std::vector<float> reference;
+        for (auto layout : {GridLayout::linear, GridLayout::bricked}) {
+            auto grid = std::make_shared<DistanceGrid>(
+                DistanceGrid::for_block(glm::vec3(-0.5f), 1.0f, nb_texels, layout));
+            double sample_time = time([&]() { grid->sample_field(field); });
+            double redistance_time =
+                time([&]() { redistance(*grid, glm::ivec3(0), grid->size); });
+            GridField grid_field(grid);
+            double probe_time = time([&]() {
+                grid_field.evaluate({probe_x.data(), probe_y.data(), probe_z.data(), nb_probes},
+                                    distances.data());
+            });
+            double ray_time = time([&]() {
+                grid_field.evaluate({ray_x.data(), ray_y.data(), ray_z.data(), ray_x.size()},
+                                    distances.data());
+            });
+
+            // Both layouts must hold the same distances
+            auto values = grid->linear_values();
+            if (reference.empty()) {
+                reference = values;
+            } else if (values != reference) {
+                std::cerr << "Error: the bricked grid differs from the linear one" << std::endl;
+                return EXIT_FAILURE;
+            }
+
+            std::cout << std::setw(8) << nb_texels << std::setw(9) << grid_layout_name(layout)
+                      << std::fixed << std::setprecision(1) << std::setw(11) << 1e3 * sample_time
+                      << std::setw(15) << 1e3 * redistance_time << std::setw(12)
+                      << 1e9 * probe_time / nb_probes << std::setw(10)
+                      << 1e9 * ray_time / ray_x.size() << std::defaultfloat << '\n';
+        }
+    }
+
+    const int nb_voxels = 512;
+    float voxel_size = 1.0f / nb_voxels;
+    OccupancyGrid occupancy{glm::ivec3(nb_voxels), glm::vec3(-0.5f + voxel_size / 2), voxel_size,
+                            std::vector<uint8_t>(static_cast<size_t>(nb_voxels) * nb_voxels *
+                                                 nb_voxels)};
+    for (int z = 0; z < nb_voxels; ++z) {
+        for (int y = 0; y < nb_voxels; ++y) {
+            for (int x = 0; x < nb_voxels; ++x) {
+                auto position = occupancy.origin + glm::vec3(x, y, z) * voxel_size;
+                occupancy.inside[(static_cast<size_t>(z) * nb_voxels + y) * nb_voxels + x] =
+                    blended_spheres(position) < 0.0f;
+            }
+        }
+    }
+    DistanceGrid transformed;
+    double transform_time = time([&]() { transformed = signed_distance_transform(occupancy); });
+    std::cout << "\nSigned distance transform of " << nb_voxels << "^3 voxels: " << std::fixed
+              << std::setprecision(2) << transform_time << " s" << std::endl;
+}
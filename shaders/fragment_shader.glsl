@@ -25,16 +25,51 @@ float roughness = 16;
 
 // sdf texture & parameters
 uniform sampler3D sdf_texture;
+uniform sampler3D normals_texture;
 uniform vec3 volume_origin;
 uniform float volume_size;
 uniform int nb_texels;
 float voxel_size = volume_size / nb_texels;
 
+// Distance format and encoding of the block (see distance_encoding.hpp)
+uniform int distance_format;
+uniform int distance_curve;
+uniform float distance_scale;
+uniform float distance_bias;
+uniform float distance_range;
+uniform float distance_mu;
+
+// Normal format of the block (see normal_encoding.hpp): rgb8, oct_rg8, oct_rg16 or none
+uniform int normal_format;
+
+// Texel layout of the block: split, or interleaved with the r8 distance in the alpha of the
+// rgb8 normal, both in sdf_texture
+uniform int texel_layout;
+
+// Distance at a position of the code axis
+float decode_position(float position) {
+    float u = (position - distance_bias) / distance_scale;
+    if (distance_curve == 1) {
+        return sign(u) * distance_range * (pow(1.0 + distance_mu, abs(u)) - 1.0) / distance_mu;
+    }
+    return u;
+}
+
+// Distance of a normalized R8 or R16 code, or of an R16F or R32F texel which holds it as is
+float decode_distance(float value) {
+    if (distance_format == 1) {
+        return decode_position((value * 65535.0 + 0.5) / 256.0);
+    } else if (distance_format >= 2) {
+        return value;
+    }
+    return decode_position(value * 255.0 + 0.5);
+}
+
 float distance_estimate(vec3 position) {
     position = position + vec3(0.5f, 0.5, 0.5);
     vec3 tex_coord = (position - volume_origin) / volume_size;
-    float value = texture(sdf_texture, position).r;
-    return value * 8.0 - 4.0;
+    vec4 texel = texture(sdf_texture, position);
+    return decode_distance(texel_layout == 1 ? texel.a : texel.r);
 }
 
 vec3 normal_estimate(vec3 p) {
@@ -45,7 +80,26 @@ vec3 normal_estimate(vec3 p) {
         k.yxy * distance_estimate(p + k.yxy * h) + k.xxx * distance_estimate(p + k.xxx * h));
 }
 
-// vec3 normal_estimate(vec3 position) {}
+vec3 octahedral_decode(vec2 point) {
+    vec3 n = vec3(point, 1.0 - abs(point.x) - abs(point.y));
+    float fold = max(-n.z, 0.0);
+    n.xy += mix(vec2(fold), vec2(-fold), greaterThanEqual(n.xy, vec2(0.0)));
+    return normalize(n);
+}
+
+// Normal from the normal texture, sampled as distance_estimate samples the distances, or from
+// the distances when the block keeps no normals
+vec3 surface_normal(vec3 position) {
+    if (normal_format == 3) {
+        return normal_estimate(position);
+    }
+    vec4 value = texel_layout == 1 ? texture(sdf_texture, position + vec3(0.5f, 0.5, 0.5))
+                                   : texture(normals_texture, position + vec3(0.5f, 0.5, 0.5));
+    if (normal_format == 0) {
+        return normalize(value.rgb * 255.0 / 128.0 - 1.0);
+    }
+    return octahedral_decode(value.rg * 2.0 - 1.0);
+}
 
 vec3 camera_direction(vec2 screen_pos) {
     return normalize(vec3(projection_inverse * vec4(screen_pos, -1.0f, 1.0f)));
@@ -85,7 +139,7 @@ void main() {
     if (intersect.y < 10) {
         color = vec3(0.0f, 1.0f, 0.0f);
     }
-    vec3 normal = normal_estimate(sphere_intercept);
+    vec3 normal = surface_normal(sphere_intercept);
     vec3 light_direction = normalize(light_pos - sphere_intercept);
     vec3 light_reflection = reflect(light_direction, normal);
     float light_distance = sphere_intersection(sphere_intercept, light_direction, 150.0f).x;
@@ -0,0 +1,149 @@
+#include <cstdlib>
+#include <cstring>
+#include <fstream>
+#include <iomanip>
+#include <iostream>
+#include <sstream>
+
+#ifdef _WIN32
+#include <process.h>
+#else
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+#include "bake_cache.hpp"
+
+namespace fs = std::filesystem;
+
+uint64_t hash_bytes(const void *bytes, size_t size, uint64_t hash) {
+    auto first = static_cast<const unsigned char *>(bytes);
+    for (size_t i = 0; i < size; ++i) {
+        hash = (hash ^ first[i]) * 1099511628211ull;
+    }
+    return hash;
+}
+
+// ************************************ //
+//          Mapped files
+// ************************************ //
+
+MappedFile::MappedFile() : bytes(nullptr), length(0) {}
+
+std::shared_ptr<const MappedFile> MappedFile::open(const std::string &path) {
+    std::shared_ptr<MappedFile> file(new MappedFile());
+#ifdef _WIN32
+    std::ifstream stream(path, std::ios::binary | std::ios::ate);
+    if (!stream) {
+        return nullptr;
+    }
+    file->buffer.resize(static_cast<size_t>(stream.tellg()));
+    stream.seekg(0);
+    stream.read(reinterpret_cast<char *>(file->buffer.data()), file->buffer.size());
+    if (!stream) {
+        return nullptr;
+    }
+    file->bytes = file->buffer.data();
+    file->length = file->buffer.size();
+#else
+    int descriptor = ::open(path.c_str(), O_RDONLY);
+    if (descriptor < 0) {
+        return nullptr;
+    }
+    struct stat status;
+    if (fstat(descriptor, &status) != 0 || status.st_size == 0) {
+        close(descriptor);
+        return nullptr;
+    }
+    void *address = mmap(nullptr, status.st_size, PROT_READ, MAP_PRIVATE, descriptor, 0);
+    // The mapping stays valid after the descriptor is closed
+    close(descriptor);
+    if (address == MAP_FAILED) {
+        return nullptr;
+    }
+    // The whole file is read once, front to back, by the texture upload
+    madvise(address, status.st_size, MADV_SEQUENTIAL);
+    madvise(address, status.st_size, MADV_WILLNEED);
+    file->bytes = static_cast<const unsigned char *>(address);
+    file->length = status.st_size;
+#endif
+    return file;
+}
+
+MappedFile::~MappedFile() {
+#ifndef _WIN32
+    if (bytes) {
+        munmap(const_cast<unsigned char *>(bytes), length);
+    }
+#endif
+}
+
+const unsigned char *MappedFile::data() const { return bytes; }
+
+size_t MappedFile::size() const { return length; }
+
+// ************************************ //
+//          Cache entries
+// ************************************ //
+
+BakeCache::BakeCache(const std::string &directory) : directory(directory) {
+    if (this->directory.empty()) {
+        const char *environment = std::getenv("SDF_BAKE_CACHE");
+        this->directory = environment ? environment : "sdf_bake_cache";
+    }
+}
+
+fs::path BakeCache::entry_path(const BakeCacheHeader &header) const {
+    std::ostringstream key;
+    key << std::hex << std::setw(16) << std::setfill('0')
+        << hash_bytes(&header, sizeof(BakeCacheHeader));
+    return directory / (key.str() + ".bake");
+}
+
+std::shared_ptr<const MappedFile> BakeCache::load(const BakeCacheHeader &header) const {
+    auto file = MappedFile::open(entry_path(header).string());
+    if (!file) {
+        return nullptr;
+    }
+    // A hash collision, or an entry truncated by a crash, must not be uploaded
+    if (file->size() != sizeof(BakeCacheHeader) + header.payload_size ||
+        std::memcmp(file->data(), &header, sizeof(BakeCacheHeader)) != 0) {
+        std::cerr << "Warning: ignoring damaged bake cache entry " << entry_path(header)
+                  << std::endl;
+        return nullptr;
+    }
+    return file;
+}
+
+bool BakeCache::store(const BakeCacheHeader &header,
+                      const std::vector<std::pair<const unsigned char *, size_t>> &payloads) const {
+    std::error_code error;
+    fs::create_directories(directory, error);
+    fs::path path = entry_path(header);
+#ifdef _WIN32
+    fs::path temporary_path = path.string() + ".tmp" + std::to_string(_getpid());
+#else
+    fs::path temporary_path = path.string() + ".tmp" + std::to_string(getpid());
+#endif
+
+    std::ofstream stream(temporary_path, std::ios::binary);
+    stream.write(reinterpret_cast<const char *>(&header), sizeof(BakeCacheHeader));
+    for (auto &[bytes, size] : payloads) {
+        stream.write(reinterpret_cast<const char *>(bytes), size);
+    }
+    stream.close();
+    if (!stream) {
+        std::cerr << "Warning: cannot write bake cache entry " << temporary_path << std::endl;
+        fs::remove(temporary_path, error);
+        return false;
+    }
+    fs::rename(temporary_path, path, error);
+    if (error) {
+        std::cerr << "Warning: cannot store bake cache entry " << path << std::endl;
+        fs::remove(temporary_path, error);
+        return false;
+    }
+    return true;
+}
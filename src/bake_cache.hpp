@@ -0,0 +1,73 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <filesystem>
+#include <memory>
+#include <string>
+#include <utility>
+#include <vector>
+
+// On-disk cache of baked blocks. An entry is named after a hash of everything its bytes depend
+// on: the scene description, the placement and resolution of the block and the version of the
+// encoding, so changing any of them can never read a stale entry. Entries are memory-mapped
+// on load and the textures are uploaded straight from the mapping.
+
+/** 64-bit FNV-1a hash of size bytes, continuing from hash */
+uint64_t hash_bytes(const void *bytes, size_t size, uint64_t hash = 14695981039346656037ull);
+
+/** Read-only mapping of a whole file, released on destruction. Windows builds read the file
+ * into memory instead. */
+class MappedFile {
+private:
+    const unsigned char *bytes;
+    size_t length;
+    std::vector<unsigned char> buffer;
+
+    MappedFile();
+
+public:
+    /** Map the file at path, or return nullptr if it cannot be opened */
+    static std::shared_ptr<const MappedFile> open(const std::string &path);
+    ~MappedFile();
+    MappedFile(const MappedFile &) = delete;
+    MappedFile &operator=(const MappedFile &) = delete;
+
+    const unsigned char *data() const;
+    size_t size() const;
+};
+
+/** Fixed-size header written in front of the payloads of an entry. Its bytes are the key of
+ * the entry, and a load only accepts a file whose header matches them exactly. */
+struct BakeCacheHeader {
+    char magic[8];
+    uint32_t encoding_version;
+    int32_t nb_texels;
+    float origin[3];
+    float block_size;
+    uint64_t scene_hash;
+    uint64_t payload_size;
+};
+
+class BakeCache {
+private:
+    std::filesystem::path directory;
+
+public:
+    /** Cache stored under directory, which defaults to $SDF_BAKE_CACHE, then to
+     * sdf_bake_cache */
+    explicit BakeCache(const std::string &directory = "");
+
+    /** Path of the entry for header */
+    std::filesystem::path entry_path(const BakeCacheHeader &header) const;
+
+    /** Mapped entry for header, or nullptr on a miss or a damaged entry. The payloads follow
+     * the header in the mapping. */
+    std::shared_ptr<const MappedFile> load(const BakeCacheHeader &header) const;
+
+    /** Write the entry for header with the (bytes, size) payloads back to back. The entry is
+     * written to a private name and renamed, so concurrent runs never map a partial file.
+     * Prints a warning and returns false on failure. */
+    bool store(const BakeCacheHeader &header,
+               const std::vector<std::pair<const unsigned char *, size_t>> &payloads) const;
+};
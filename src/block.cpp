@@ -1,78 +1,668 @@
 #include <algorithm>
+#include <atomic>
+#include <cmath>
+#include <cstring>
 #include <iostream>
+#include <numeric>
 
 #include "block.hpp"
+#include "brush_field.hpp"
+#include "gpu_baker.hpp"
+#include "thread_pool.hpp"
 
-Block::Block() : block_size{0.0f}, nb_texels{0}, sdf{nullptr} {}
+// Top-level bricks handed to the threads, and the size below which a box that cannot be
+// culled is evaluated texel by texel
+static const int brick_size = 16;
+static const int leaf_size = 4;
 
-Block::Block(glm::vec3 origin, float block_size, int nb_texels, float (*sdf)(glm::vec3)) {
+// Bounds are computed without outward rounding, so keep a small safety margin
+static const float bound_margin = 1e-4f;
+
+Block::Block()
+    : block_size{0.0f}, nb_texels{0}, strategy{BakeStrategy::interval_culling}, statistics{},
+      encoding_mode{EncodingMode::fixed}, encoding{DistanceEncoding::fixed()},
+      format{DistanceFormat::r8}, normals_format{NormalFormat::rgb8},
+      layout{TexelLayout::split}, interleaved{false} {}
+
+Block::Block(glm::vec3 origin, float block_size, int nb_texels, float (*sdf)(glm::vec3))
+    : Block(origin, block_size, nb_texels, std::make_shared<FunctionField>(sdf)) {}
+
+Block::Block(glm::vec3 origin, float block_size, int nb_texels,
+             std::shared_ptr<const SdfField> field)
+    : strategy{BakeStrategy::interval_culling}, statistics{}, encoding_mode{EncodingMode::fixed},
+      encoding{DistanceEncoding::fixed()}, format{DistanceFormat::r8},
+      normals_format{NormalFormat::rgb8}, layout{TexelLayout::split}, interleaved{false} {
     this->block_size = block_size;
     this->origin = origin;
     this->nb_texels = nb_texels;
-    this->sdf = sdf;
+    this->field = std::move(field);
 }
 
-static const glm::vec3 dir1 = glm::vec3(1.0f, -1.0f, -1.0f);
-static const glm::vec3 dir2 = glm::vec3(-1.0f, -1.0f, 1.0f);
-static const glm::vec3 dir3 = glm::vec3(-1.0f, 1.0f, -1.0f);
-static const glm::vec3 dir4 = glm::vec3(1.0f, 1.0f, 1.0f);
-static const float h = 0.0001;
-
-void Block::generate_textures() {
+glm::vec3 Block::texel_center(glm::ivec3 texel) const {
     auto texel_size = block_size / nb_texels;
     auto sample_offset = glm::vec3(1.0f) * (texel_size / 2);
+    return glm::vec3(texel) * texel_size + origin + sample_offset;
+}
+
+size_t Block::distance_stride() const {
+    return interleaved ? 4 : distance_texel_bytes(format);
+}
+
+size_t Block::normal_stride() const {
+    return interleaved ? 4 : normal_texel_bytes(normals_format);
+}
+
+void Block::choose_layout() {
+    interleaved = layout == TexelLayout::interleaved && format == DistanceFormat::r8 &&
+                  normals_format == NormalFormat::rgb8;
+    if (layout == TexelLayout::interleaved && !interleaved) {
+        std::cerr << "Warning: the interleaved layout needs r8 distances and rgb8 normals, "
+                     "baking split textures instead"
+                  << std::endl;
+    }
+}
+
+uint32_t Block::distance_texel(float distance) const {
+    switch (format) {
+    case DistanceFormat::r16:
+        return encoding.encode16(distance);
+    case DistanceFormat::r16f:
+        return float_to_half(glm::clamp(distance, -max_distance, max_distance));
+    case DistanceFormat::r32f: {
+        float clamped = glm::clamp(distance, -max_distance, max_distance);
+        uint32_t bits;
+        std::memcpy(&bits, &clamped, sizeof(bits));
+        return bits;
+    }
+    case DistanceFormat::r8:
+        break;
+    }
+    return encoding.encode(distance);
+}
+
+float Block::saturation_distance() const {
+    // The float formats only clamp
+    if (format == DistanceFormat::r16f || format == DistanceFormat::r32f) {
+        return max_distance;
+    }
+    return encoding.saturation_distance();
+}
+
+void Block::fill_distances(GLubyte *sdf_bytes, size_t index, size_t count,
+                           uint32_t texel) const {
+    size_t stride = distance_stride();
+    switch (distance_texel_bytes(format)) {
+    case 1:
+        if (stride == 1) {
+            std::fill_n(sdf_bytes + index, count, static_cast<GLubyte>(texel));
+            break;
+        }
+        for (size_t i = 0; i < count; ++i) {
+            sdf_bytes[stride * (index + i)] = static_cast<GLubyte>(texel);
+        }
+        break;
+    case 2: {
+        auto half_texel = static_cast<uint16_t>(texel);
+        for (size_t i = 0; i < count; ++i) {
+            std::memcpy(sdf_bytes + stride * (index + i), &half_texel, 2);
+        }
+        break;
+    }
+    default:
+        for (size_t i = 0; i < count; ++i) {
+            std::memcpy(sdf_bytes + stride * (index + i), &texel, 4);
+        }
+    }
+}
+
+void Block::fill_zero_normals(GLubyte *normals_bytes, size_t index, size_t count) const {
+    size_t texel_bytes = normal_texel_bytes(normals_format);
+    if (texel_bytes == 0) {
+        return;
+    }
+    size_t stride = normal_stride();
+    GLubyte zero_texel[4];
+    encode_normal(normals_format, glm::vec3(0.0f), zero_texel);
+    for (size_t i = 0; i < count; ++i) {
+        std::memcpy(normals_bytes + stride * (index + i), zero_texel, texel_bytes);
+    }
+}
 
-    std::vector<GLubyte> sdf_bytes(nb_texels * nb_texels * nb_texels);
-    std::vector<GLubyte> normals_bytes(3 * nb_texels * nb_texels * nb_texels);
-    auto it_sdf = sdf_bytes.begin();
-    auto it_normals = normals_bytes.begin();
+float Block::read_distance(const GLubyte *sdf_bytes, size_t index) const {
+    uint16_t code;
+    float distance;
+    switch (format) {
+    case DistanceFormat::r16:
+        std::memcpy(&code, sdf_bytes + 2 * index, 2);
+        return encoding.decode16(code);
+    case DistanceFormat::r16f:
+        std::memcpy(&code, sdf_bytes + 2 * index, 2);
+        return half_to_float(code);
+    case DistanceFormat::r32f:
+        std::memcpy(&distance, sdf_bytes + 4 * index, 4);
+        return distance;
+    case DistanceFormat::r8:
+        break;
+    }
+    return encoding.decode(sdf_bytes[distance_stride() * index]);
+}
+
+size_t Block::BakeJob::index(glm::ivec3 texel) const {
+    auto local = texel - buffer_min;
+    return (static_cast<size_t>(local.z) * buffer_size.y + local.y) * buffer_size.x + local.x;
+}
 
-    for (int z = 0; z < nb_texels; ++z) {
-        for (int y = 0; y < nb_texels; ++y) {
-            for (int x = 0; x < nb_texels; ++x) {
-                auto sample_position = glm::vec3(x, y, z) * texel_size + origin + sample_offset;
+Interval Block::bound_box(const SdfField &brick_field, glm::ivec3 box_min,
+                          glm::ivec3 box_max) const {
+    auto first_center = texel_center(box_min);
+    auto last_center = texel_center(box_max - 1);
+    if (strategy == BakeStrategy::interval_culling) {
+        return brick_field.evaluate_interval(first_center, last_center);
+    }
+
+    // A 1-Lipschitz field cannot move by more than the distance to the box center
+    auto center = (first_center + last_center) * 0.5f;
+    auto radius = glm::length(last_center - first_center) * 0.5f;
+    auto distance = brick_field.distance(center);
+    return {distance - radius, distance + radius};
+}
+
+void Block::bake_box(const SdfField &brick_field, glm::ivec3 box_min, glm::ivec3 box_max,
+                     const BakeJob &job, BakeStatistics &box_statistics) const {
+    if (strategy != BakeStrategy::dense) {
+        auto bounds = bound_box(brick_field, box_min, box_max);
+        ++box_statistics.bound_evaluations;
+        if (bounds.lower == -INFINITY && bounds.upper == INFINITY) {
+            // The field cannot bound anything, no need to subdivide. An empty field is
+            // {+inf, +inf} instead and saturates below
+            box_statistics.evaluated_texels +=
+                evaluate_box(brick_field, box_min, box_max, job);
+            return;
+        }
+
+        // Every format is monotonic, so a saturated texel at both ends holds for the whole box
+        auto lower = distance_texel(bounds.lower - bound_margin);
+        auto upper = distance_texel(bounds.upper + bound_margin);
+        if (lower == upper && (lower == distance_texel(-INFINITY) ||
+                               lower == distance_texel(INFINITY))) {
+            for (int z = box_min.z; z < box_max.z; ++z) {
+                for (int y = box_min.y; y < box_max.y; ++y) {
+                    auto index = job.index(glm::ivec3(box_min.x, y, z));
+                    int row_length = box_max.x - box_min.x;
+                    fill_distances(job.sdf_bytes, index, row_length, lower);
+                    // Normals far from the surface are not used, store the zero vector
+                    fill_zero_normals(job.normals_bytes, index, row_length);
+                    box_statistics.skipped_texels += row_length;
+                }
+            }
+            return;
+        }
+
+        auto extent = box_max - box_min;
+        if (std::max({extent.x, extent.y, extent.z}) > leaf_size) {
+            auto middle = box_min + glm::max(extent / 2, glm::ivec3(1));
+            for (int octant = 0; octant < 8; ++octant) {
+                glm::ivec3 child_min, child_max;
+                for (int axis = 0; axis < 3; ++axis) {
+                    bool upper_half = (octant >> axis) & 1;
+                    child_min[axis] = upper_half ? middle[axis] : box_min[axis];
+                    child_max[axis] = upper_half ? box_max[axis] : middle[axis];
+                }
+                if (child_min.x < child_max.x && child_min.y < child_max.y &&
+                    child_min.z < child_max.z) {
+                    bake_box(brick_field, child_min, child_max, job, box_statistics);
+                }
+            }
+            return;
+        }
+    }
+    box_statistics.evaluated_texels += evaluate_box(brick_field, box_min, box_max, job);
+}
+
+size_t Block::evaluate_box(const SdfField &brick_field, glm::ivec3 box_min, glm::ivec3 box_max,
+                           const BakeJob &job) const {
+    auto extent = box_max - box_min;
+    size_t count = static_cast<size_t>(extent.x) * extent.y * extent.z;
+
+    // Sample positions of the whole box in SoA layout, and the field values at them
+    std::vector<float> position_x(count), position_y(count), position_z(count);
+    std::vector<float> distances(count);
+    std::vector<float> gradient_x(count), gradient_y(count), gradient_z(count);
+
+    size_t i = 0;
+    for (int z = box_min.z; z < box_max.z; ++z) {
+        for (int y = box_min.y; y < box_max.y; ++y) {
+            for (int x = box_min.x; x < box_max.x; ++x) {
+                auto sample_position = texel_center(glm::ivec3(x, y, z));
+                position_x[i] = sample_position.x;
+                position_y[i] = sample_position.y;
+                position_z[i] = sample_position.z;
+                ++i;
+            }
+        }
+    }
+    brick_field.evaluate_gradient(
+        {position_x.data(), position_y.data(), position_z.data(), count}, distances.data(),
+        gradient_x.data(), gradient_y.data(), gradient_z.data());
+
+    size_t stride = normal_stride();
+    i = 0;
+    for (int z = box_min.z; z < box_max.z; ++z) {
+        for (int y = box_min.y; y < box_max.y; ++y) {
+            auto index = job.index(glm::ivec3(box_min.x, y, z));
+            for (int x = box_min.x; x < box_max.x; ++x, ++index, ++i) {
                 // distance
-                float distance = sdf(sample_position);
-                distance = std::clamp(distance, -4.0f, 4.0f) + 4.0f;
-                distance *= 32.0f;
-                *it_sdf++ = static_cast<GLubyte>(distance);
-
-                // normal
-                glm::vec3 normal = glm::normalize(dir1 * sdf(sample_position + dir1 * h) +
-                                                  dir2 * sdf(sample_position + dir2 * h) +
-                                                  dir3 * sdf(sample_position + dir3 * h) +
-                                                  dir4 * sdf(sample_position + dir4 * h));
-                normal = (normal + glm::vec3(1.0f, 1.0f, 1.0f)) * 128.0f;
-                GLubyte normal_x = static_cast<GLubyte>(normal.x);
-                GLubyte normal_y = static_cast<GLubyte>(normal.y);
-                GLubyte normal_z = static_cast<GLubyte>(normal.z);
-                *it_normals++ = normal_x;
-                *it_normals++ = normal_y;
-                *it_normals++ = normal_z;
+                fill_distances(job.sdf_bytes, index, 1, distance_texel(distances[i]));
+
+                // normal, the zero vector where the field is flat
+                glm::vec3 normal = glm::vec3(gradient_x[i], gradient_y[i], gradient_z[i]);
+                normal = glm::dot(normal, normal) > 0.0f ? glm::normalize(normal) : normal;
+                encode_normal(normals_format, normal, job.normals_bytes + stride * index);
             }
         }
     }
+    return count;
+}
 
-    sdf_texture = Texture(std::move(sdf_bytes));
-    sdf_texture.send_texture_3D(GL_R8, nb_texels, nb_texels, nb_texels, GL_RED);
+BakeStatistics Block::bake_jobs(const std::vector<BakeJob> &jobs) const {
+    // Bricks of all the jobs are spread over the threads together, first_bricks[j] being the
+    // first brick of job j
+    std::vector<int> first_bricks(jobs.size() + 1, 0);
+    for (size_t j = 0; j < jobs.size(); ++j) {
+        auto nb_bricks = (jobs[j].region_max - jobs[j].region_min + brick_size - 1) / brick_size;
+        first_bricks[j + 1] = first_bricks[j] + nb_bricks.x * nb_bricks.y * nb_bricks.z;
+    }
+
+    // Each brick writes its own texels, so the result does not depend on the order in which
+    // the threads process them
+    std::atomic<size_t> nb_evaluated{0}, nb_skipped{0}, nb_bound_evaluations{0};
+    float reach = saturation_distance();
+    ThreadPool::global().parallel_for(first_bricks.back(), [&](int brick) {
+        size_t j = std::upper_bound(first_bricks.begin(), first_bricks.end(), brick) -
+                   first_bricks.begin() - 1;
+        auto &job = jobs[j];
+        auto nb_bricks = (job.region_max - job.region_min + brick_size - 1) / brick_size;
+        brick -= first_bricks[j];
+        auto box_min = job.region_min + glm::ivec3(brick % nb_bricks.x,
+                                                   (brick / nb_bricks.x) % nb_bricks.y,
+                                                   brick / (nb_bricks.x * nb_bricks.y)) *
+                                            brick_size;
+        auto box_max = glm::min(box_min + brick_size, job.region_max);
+        // Let the field drop whatever cannot bring this brick below saturation
+        auto brick_field =
+            field->restrict_to(texel_center(box_min), texel_center(box_max - 1), reach);
+        BakeStatistics brick_statistics{};
+        bake_box(brick_field ? *brick_field : *field, box_min, box_max, job, brick_statistics);
+        nb_evaluated += brick_statistics.evaluated_texels;
+        nb_skipped += brick_statistics.skipped_texels;
+        nb_bound_evaluations += brick_statistics.bound_evaluations;
+    });
+    return {nb_evaluated, nb_skipped, nb_bound_evaluations};
+}
 
+BakeStatistics Block::bake_region(glm::ivec3 region_min, glm::ivec3 region_max,
+                                  GLubyte *sdf_bytes, GLubyte *normals_bytes) const {
+    return bake_jobs({{region_min, region_max, glm::ivec3(0), glm::ivec3(nb_texels), sdf_bytes,
+                       normals_bytes}});
+}
+
+BakeStatistics Block::bake_bytes(std::vector<GLubyte> &sdf_bytes,
+                                 std::vector<GLubyte> &normals_bytes) {
+    encoding = choose_encoding(encoding_mode, *field, origin, block_size, nb_texels);
+    interleaved = false;
+    size_t nb_total = static_cast<size_t>(nb_texels) * nb_texels * nb_texels;
+    sdf_bytes.resize(distance_texel_bytes(format) * nb_total);
+    normals_bytes.resize(normal_texel_bytes(normals_format) * nb_total);
+    return bake_region(glm::ivec3(0), glm::ivec3(nb_texels), sdf_bytes.data(),
+                       normals_bytes.data());
+}
+
+void Block::generate_textures() {
+    std::vector<GLubyte> sdf_bytes, normals_bytes;
+    choose_layout();
+    if (interleaved) {
+        // Normals and distance codes written in the same pass over the RGBA bytes
+        encoding = choose_encoding(encoding_mode, *field, origin, block_size, nb_texels);
+        sdf_bytes.resize(4 * static_cast<size_t>(nb_texels) * nb_texels * nb_texels);
+        statistics = bake_region(glm::ivec3(0), glm::ivec3(nb_texels), sdf_bytes.data() + 3,
+                                 sdf_bytes.data());
+    } else {
+        statistics = bake_bytes(sdf_bytes, normals_bytes);
+    }
+    dirty_regions.clear();
+    gpu_baker.reset();
+
+    sdf_texture = Texture(std::move(sdf_bytes));
     normals_texture = Texture(std::move(normals_bytes));
-    normals_texture.send_texture_3D(GL_RGB8, nb_texels, nb_texels, nb_texels, GL_RGB);
+    if (interleaved) {
+        sdf_texture.send_texture_3D(GL_RGBA8, nb_texels, nb_texels, nb_texels, GL_RGBA);
+        return;
+    }
+    sdf_texture.send_texture_3D(distance_internal_format(format), nb_texels, nb_texels, nb_texels,
+                                GL_RED, distance_pixel_type(format));
+    if (normals_format != NormalFormat::none) {
+        normals_texture.send_texture_3D(normal_internal_format(normals_format), nb_texels,
+                                        nb_texels, nb_texels, normal_pixel_format(normals_format),
+                                        normal_pixel_type(normals_format));
+    }
+}
+
+bool Block::refresh_gpu_baker() {
+    auto brushes = std::dynamic_pointer_cast<const BrushField>(field);
+    if (!brushes || !GpuBaker::is_supported()) {
+        return false;
+    }
+    // Only compile a new shader when the scene changed
+    auto baked_layout = interleaved ? TexelLayout::interleaved : TexelLayout::split;
+    if (!gpu_baker || gpu_baker->shader_source() !=
+                          generate_bake_shader(*brushes, format, normals_format, baked_layout)) {
+        gpu_baker = std::make_shared<GpuBaker>(*brushes, format, normals_format, baked_layout);
+    }
+    return true;
+}
+
+void Block::generate_textures_gpu() {
+    choose_layout();
+    if (!refresh_gpu_baker()) {
+        std::cerr << "Warning: GPU baking needs a brush scene and an OpenGL 4.3 context, "
+                     "baking on the CPU instead"
+                  << std::endl;
+        generate_textures();
+        return;
+    }
+
+    // Storage only, the compute shader fills it
+    sdf_texture = Texture();
+    normals_texture = Texture();
+    if (interleaved) {
+        sdf_texture.send_texture_3D(GL_RGBA8, nb_texels, nb_texels, nb_texels, GL_RGBA,
+                                    GL_UNSIGNED_BYTE, nullptr);
+    } else {
+        sdf_texture.send_texture_3D(distance_internal_format(format), nb_texels, nb_texels,
+                                    nb_texels, GL_RED, distance_pixel_type(format), nullptr);
+        if (normals_format == NormalFormat::rgb8) {
+            normals_texture.send_texture_3D(GL_RGBA8, nb_texels, nb_texels, nb_texels, GL_RGBA,
+                                            GL_UNSIGNED_BYTE, nullptr);
+        } else if (normals_format != NormalFormat::none) {
+            normals_texture.send_texture_3D(normal_internal_format(normals_format), nb_texels,
+                                            nb_texels, nb_texels,
+                                            normal_pixel_format(normals_format),
+                                            normal_pixel_type(normals_format), nullptr);
+        }
+    }
+
+    encoding = choose_encoding(encoding_mode, *field, origin, block_size, nb_texels);
+    gpu_baker->bake(sdf_texture, normals_texture, origin, block_size, nb_texels, encoding,
+                    glm::ivec3(0), glm::ivec3(nb_texels));
+    size_t nb_total = static_cast<size_t>(nb_texels) * nb_texels * nb_texels;
+    statistics = {nb_total, 0, 0};
+    dirty_regions.clear();
+}
+
+void Block::set_field(std::shared_ptr<const SdfField> field) { this->field = std::move(field); }
+
+void Block::mark_dirty(glm::vec3 box_min, glm::vec3 box_max) {
+    auto texel_size = block_size / nb_texels;
+    // Texel i is centered on origin + (i + 0.5) * texel_size
+    glm::ivec3 region_min = glm::ceil((box_min - origin) / texel_size - 0.5f);
+    glm::ivec3 region_max = glm::floor((box_max - origin) / texel_size - 0.5f) + 1.0f;
+    region_min = glm::clamp(region_min, glm::ivec3(0), glm::ivec3(nb_texels));
+    region_max = glm::clamp(region_max, glm::ivec3(0), glm::ivec3(nb_texels));
+    if (glm::any(glm::greaterThanEqual(region_min, region_max))) {
+        return;
+    }
+
+    // Snap to whole bricks, so the octants are split exactly as in a full bake and the
+    // re-baked texels match it byte for byte
+    region_min = region_min / brick_size * brick_size;
+    region_max = glm::min((region_max + brick_size - 1) / brick_size * brick_size,
+                          glm::ivec3(nb_texels));
+
+    // Merge with every overlapping region so that no texel is baked twice
+    bool merged = true;
+    while (merged) {
+        merged = false;
+        for (auto it = dirty_regions.begin(); it != dirty_regions.end(); ++it) {
+            if (glm::all(glm::lessThan(it->first, region_max)) &&
+                glm::all(glm::lessThan(region_min, it->second))) {
+                region_min = glm::min(region_min, it->first);
+                region_max = glm::max(region_max, it->second);
+                dirty_regions.erase(it);
+                merged = true;
+                break;
+            }
+        }
+    }
+    dirty_regions.emplace_back(region_min, region_max);
+}
+
+void Block::update_textures() {
+    statistics = {};
+    if (gpu_baker) {
+        if (!refresh_gpu_baker()) {
+            // Nothing on the CPU to patch, bake the new field from scratch
+            generate_textures();
+            return;
+        }
+        for (auto &[region_min, region_max] : dirty_regions) {
+            gpu_baker->bake(sdf_texture, normals_texture, origin, block_size, nb_texels,
+                            encoding, region_min, region_max);
+            auto extent = region_max - region_min;
+            statistics.evaluated_texels += static_cast<size_t>(extent.x) * extent.y * extent.z;
+        }
+        dirty_regions.clear();
+        return;
+    }
+    if (!sdf_texture.has_cpu_copy() && !dirty_regions.empty()) {
+        // Loaded from the bake cache, nothing on the CPU to patch
+        generate_textures();
+        return;
+    }
+    // Interleaved normals are the RGBA bytes of the distance texture
+    GLubyte *sdf_bytes = interleaved ? sdf_texture.data() + 3 : sdf_texture.data();
+    GLubyte *normals_bytes = interleaved ? sdf_texture.data() : normals_texture.data();
+    for (auto &[region_min, region_max] : dirty_regions) {
+        auto region_statistics = bake_region(region_min, region_max, sdf_bytes, normals_bytes);
+        statistics.evaluated_texels += region_statistics.evaluated_texels;
+        statistics.skipped_texels += region_statistics.skipped_texels;
+        statistics.bound_evaluations += region_statistics.bound_evaluations;
+
+        auto extent = region_max - region_min;
+        if (interleaved) {
+            sdf_texture.update_texture_3D(region_min.x, region_min.y, region_min.z, extent.x,
+                                          extent.y, extent.z, GL_RGBA);
+            continue;
+        }
+        sdf_texture.update_texture_3D(region_min.x, region_min.y, region_min.z, extent.x,
+                                      extent.y, extent.z, GL_RED, distance_pixel_type(format));
+        if (normals_format != NormalFormat::none) {
+            normals_texture.update_texture_3D(region_min.x, region_min.y, region_min.z, extent.x,
+                                              extent.y, extent.z,
+                                              normal_pixel_format(normals_format),
+                                              normal_pixel_type(normals_format));
+        }
+    }
+    dirty_regions.clear();
+}
+
+BakeCacheHeader Block::cache_header(const std::string &scene_description) const {
+    // Zeroed first, so that the key does not depend on uninitialized bytes
+    BakeCacheHeader header;
+    std::memset(&header, 0, sizeof(BakeCacheHeader));
+    std::memcpy(header.magic, "SDFBAKE", 8);
+    header.encoding_version = encoding_version;
+    header.nb_texels = nb_texels;
+    header.origin[0] = origin.x;
+    header.origin[1] = origin.y;
+    header.origin[2] = origin.z;
+    header.block_size = block_size;
+    // The encoding depends on the field, so the key holds the mode and the entry the encoding
+    auto hash = hash_bytes(scene_description.data(), scene_description.size());
+    hash = hash_bytes(&encoding_mode, sizeof(EncodingMode), hash);
+    hash = hash_bytes(&format, sizeof(DistanceFormat), hash);
+    hash = hash_bytes(&normals_format, sizeof(NormalFormat), hash);
+    // Interleaved entries hold the same bytes per texel in another order
+    header.scene_hash = hash_bytes(&interleaved, sizeof(bool), hash);
+    header.payload_size =
+        sizeof(DistanceEncoding) +
+        (distance_texel_bytes(format) + normal_texel_bytes(normals_format)) *
+            static_cast<uint64_t>(nb_texels) * nb_texels * nb_texels;
+    return header;
+}
+
+bool Block::load_cached(const BakeCache &cache, const std::string &scene_description) {
+    // The key depends on the layout of the entry, the current textures keep theirs on a miss
+    bool current_interleaved = interleaved;
+    choose_layout();
+    auto file = cache.load(cache_header(scene_description));
+    if (!file) {
+        interleaved = current_interleaved;
+        return false;
+    }
+    size_t nb_total = static_cast<size_t>(nb_texels) * nb_texels * nb_texels;
+    std::memcpy(&encoding, file->data() + sizeof(BakeCacheHeader), sizeof(DistanceEncoding));
+    auto sdf_bytes = file->data() + sizeof(BakeCacheHeader) + sizeof(DistanceEncoding);
+    sdf_texture = Texture();
+    normals_texture = Texture();
+    if (interleaved) {
+        sdf_texture.send_texture_3D(GL_RGBA8, nb_texels, nb_texels, nb_texels, GL_RGBA,
+                                    GL_UNSIGNED_BYTE, sdf_bytes);
+    } else {
+        sdf_texture.send_texture_3D(distance_internal_format(format), nb_texels, nb_texels,
+                                    nb_texels, GL_RED, distance_pixel_type(format), sdf_bytes);
+    }
+    if (!interleaved && normals_format != NormalFormat::none) {
+        normals_texture.send_texture_3D(normal_internal_format(normals_format), nb_texels,
+                                        nb_texels, nb_texels, normal_pixel_format(normals_format),
+                                        normal_pixel_type(normals_format),
+                                        sdf_bytes + distance_texel_bytes(format) * nb_total);
+    }
+
+    statistics = {};
+    dirty_regions.clear();
+    gpu_baker.reset();
+    return true;
+}
+
+bool Block::store_cached(const BakeCache &cache, const std::string &scene_description) const {
+    if (!sdf_texture.has_cpu_copy() || gpu_baker) {
+        return false;
+    }
+    size_t nb_total = static_cast<size_t>(nb_texels) * nb_texels * nb_texels;
+    // Interleaved textures have all their bytes in the distance texture
+    size_t sdf_bytes = interleaved ? 4 * nb_total : distance_texel_bytes(format) * nb_total;
+    size_t normal_bytes = interleaved ? 0 : normal_texel_bytes(normals_format) * nb_total;
+    return cache.store(cache_header(scene_description),
+                       {{reinterpret_cast<const unsigned char *>(&encoding), sizeof(encoding)},
+                        {sdf_texture.data(), sdf_bytes},
+                        {normals_texture.data(), normal_bytes}});
+}
+
+BakeStatistics Block::bake_chunks(const ChunkedVolume &volume, const std::vector<size_t> &chunks,
+                                  size_t memory_budget) {
+    if (volume.nb_texels() != nb_texels || volume.origin() != origin ||
+        volume.block_size() != block_size || volume.encoding_version() != encoding_version) {
+        std::cerr << "Error: the chunked volume was not created for this block" << std::endl;
+        abort();
+    }
+    // Workers baking shards of the same volume must all use the encoding it was created with
+    encoding = volume.distance_encoding();
+    format = volume.distance_format();
+    normals_format = volume.normal_format();
+    interleaved = false;
+
+    // The chunks of a batch are baked together, so that small chunks still keep every thread
+    // busy, then written out one after the other
+    size_t chunk_bytes = volume.chunk_bytes();
+    size_t sdf_chunk_bytes = distance_texel_bytes(format) * volume.chunk_texels();
+    auto chunk_size = glm::ivec3(volume.chunk_size());
+    size_t batch_size = std::min(std::max<size_t>(memory_budget / chunk_bytes, 1), chunks.size());
+    std::vector<GLubyte> batch_bytes(batch_size * chunk_bytes);
+
+    BakeStatistics total_statistics{};
+    for (size_t first = 0; first < chunks.size(); first += batch_size) {
+        size_t count = std::min(batch_size, chunks.size() - first);
+        // The padding of chunks crossing the end of the volume is never baked, keep it zero
+        std::fill(batch_bytes.begin(), batch_bytes.end(), 0);
+        std::vector<BakeJob> jobs;
+        for (size_t i = 0; i < count; ++i) {
+            auto chunk_min = volume.chunk_min(chunks[first + i]);
+            auto chunk_max = glm::min(chunk_min + chunk_size, glm::ivec3(nb_texels));
+            GLubyte *sdf_bytes = batch_bytes.data() + i * chunk_bytes;
+            jobs.push_back({chunk_min, chunk_max, chunk_min, chunk_size, sdf_bytes,
+                            sdf_bytes + sdf_chunk_bytes});
+        }
+        auto batch_statistics = bake_jobs(jobs);
+        total_statistics.evaluated_texels += batch_statistics.evaluated_texels;
+        total_statistics.skipped_texels += batch_statistics.skipped_texels;
+        total_statistics.bound_evaluations += batch_statistics.bound_evaluations;
+
+        for (size_t i = 0; i < count; ++i) {
+            volume.write_chunk(chunks[first + i], jobs[i].sdf_bytes, jobs[i].normals_bytes);
+        }
+    }
+    return total_statistics;
 }
 
+BakeStatistics Block::bake_to_file(const std::string &path, int chunk_size,
+                                   size_t memory_budget) {
+    auto volume = ChunkedVolume::create(
+        path, origin, block_size, nb_texels, chunk_size, encoding_version,
+        choose_encoding(encoding_mode, *field, origin, block_size, nb_texels), format,
+        normals_format);
+    std::vector<size_t> chunks(volume.chunk_count());
+    std::iota(chunks.begin(), chunks.end(), 0);
+    return bake_chunks(volume, chunks, memory_budget);
+}
+
+void Block::set_bake_strategy(BakeStrategy strategy) { this->strategy = strategy; }
+
+void Block::set_encoding_mode(EncodingMode mode) { encoding_mode = mode; }
+
+DistanceEncoding Block::distance_encoding() const { return encoding; }
+
+void Block::set_distance_format(DistanceFormat format) { this->format = format; }
+
+DistanceFormat Block::distance_format() const { return format; }
+
+void Block::set_distance_uniforms(GLuint program) const {
+    glUniform1i(glGetUniformLocation(program, "distance_format"), static_cast<GLint>(format));
+    glUniform1i(glGetUniformLocation(program, "texel_layout"), interleaved ? 1 : 0);
+    encoding.set_uniforms(program);
+}
+
+void Block::set_normal_format(NormalFormat format) { normals_format = format; }
+
+NormalFormat Block::normal_format() const { return normals_format; }
+
+void Block::set_normal_uniforms(GLuint program) const {
+    glUniform1i(glGetUniformLocation(program, "normal_format"),
+                static_cast<GLint>(normals_format));
+}
+
+void Block::set_texel_layout(TexelLayout layout) { this->layout = layout; }
+
+TexelLayout Block::texel_layout() const { return layout; }
+
+BakeStatistics Block::bake_statistics() const { return statistics; }
+
 void Block::bind_textures() const {
     sdf_texture.bind_texture(0);
     normals_texture.bind_texture(1);
 }
 
 void Block::print_slice(int z) const {
+    if (!sdf_texture.has_cpu_copy()) {
+        std::cout << "The distances only live on the GPU" << std::endl;
+        return;
+    }
+    auto sdf_bytes = interleaved ? sdf_texture.data() + 3 : sdf_texture.data();
     for (int y = 0; y < nb_texels; ++y) {
         for (int x = 0; x < nb_texels; ++x) {
-            GLubyte discrete_dist =
-                sdf_texture.data()[z * nb_texels * nb_texels + y * nb_texels + x];
-            float distance = static_cast<float>(discrete_dist) / 32.0f - 4.0f;
+            size_t index = (static_cast<size_t>(z) * nb_texels + y) * nb_texels + x;
+            float distance = read_distance(sdf_bytes, index);
             std::cout << distance << '\t';
         }
         std::cout << '\n';
     }
-}
\ No newline at end of file
+}
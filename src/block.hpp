@@ -1,12 +1,39 @@
 #pragma once
 
+#include "bake_cache.hpp"
+#include "chunked_volume.hpp"
+#include "distance_encoding.hpp"
+#include "normal_encoding.hpp"
+#include "sdf_field.hpp"
 #include "texture.hpp"
 #include <glad/glad.hpp>
 #include <glm/glm.hpp>
 #include <glm/gtc/matrix_transform.hpp>
 #include <glm/gtc/type_ptr.hpp>
+#include <cstdint>
+#include <memory>
+#include <string>
+#include <utility>
 #include <vector>
 
+class GpuBaker;
+
+/** How generate_textures decides which texels need a field evaluation.
+ * dense evaluates every texel. interval_culling bounds octants with
+ * SdfField::evaluate_interval. narrow_band probes the field at octant centers and relies on
+ * the field being 1-Lipschitz to bound the whole octant. In the last two, octants that
+ * saturate the encoding are filled without evaluation and the others are refined. */
+enum class BakeStrategy { dense, interval_culling, narrow_band };
+
+/** Number of texels whose field was evaluated during the last bake, number of texels
+ * filled directly because their whole region was proven to saturate the encoding, and
+ * number of extra evaluations spent on bounding regions */
+struct BakeStatistics {
+    size_t evaluated_texels;
+    size_t skipped_texels;
+    size_t bound_evaluations;
+};
+
 class Block {
 private:
     Texture sdf_texture;
@@ -14,14 +41,155 @@ private:
     float block_size;
     glm::vec3 origin;
     int nb_texels;
-    float (*sdf)(glm::vec3);
+    std::shared_ptr<const SdfField> field;
+    BakeStrategy strategy;
+    BakeStatistics statistics;
+    EncodingMode encoding_mode;
+    // Encoding of the current textures, chosen by each full bake and kept by update_textures
+    DistanceEncoding encoding;
+    DistanceFormat format;
+    NormalFormat normals_format;
+    TexelLayout layout;
+    // Whether the current textures are interleaved, chosen by each full bake like the encoding
+    bool interleaved;
+    // Texel boxes [min, max) waiting for update_textures, kept disjoint
+    std::vector<std::pair<glm::ivec3, glm::ivec3>> dirty_regions;
+    // Set while the textures come from generate_textures_gpu, which keeps no CPU copy
+    std::shared_ptr<GpuBaker> gpu_baker;
+
+    // Texels [region_min, region_max) to bake, written to buffers that hold the texels
+    // [buffer_min, buffer_min + buffer_size) in x-fastest order. Interleaved buffers are the
+    // same RGBA bytes, sdf_bytes pointing at the first alpha.
+    struct BakeJob {
+        glm::ivec3 region_min;
+        glm::ivec3 region_max;
+        glm::ivec3 buffer_min;
+        glm::ivec3 buffer_size;
+        GLubyte *sdf_bytes;
+        GLubyte *normals_bytes;
+
+        size_t index(glm::ivec3 texel) const;
+    };
+
+    glm::vec3 texel_center(glm::ivec3 texel) const;
+    // Bytes from one texel to the next in the distance and normal buffers
+    size_t distance_stride() const;
+    size_t normal_stride() const;
+    // Set interleaved from the layout and the formats at the start of a full bake
+    void choose_layout();
+    // Bits of the distance texel of a distance in the current format and encoding, and the
+    // writes of such texels at texel index of a distance buffer
+    uint32_t distance_texel(float distance) const;
+    // Distance beyond which every distance texel saturates
+    float saturation_distance() const;
+    void fill_distances(GLubyte *sdf_bytes, size_t index, size_t count, uint32_t texel) const;
+    void fill_zero_normals(GLubyte *normals_bytes, size_t index, size_t count) const;
+    float read_distance(const GLubyte *sdf_bytes, size_t index) const;
+    Interval bound_box(const SdfField &brick_field, glm::ivec3 box_min,
+                       glm::ivec3 box_max) const;
+    void bake_box(const SdfField &brick_field, glm::ivec3 box_min, glm::ivec3 box_max,
+                  const BakeJob &job, BakeStatistics &box_statistics) const;
+    size_t evaluate_box(const SdfField &brick_field, glm::ivec3 box_min, glm::ivec3 box_max,
+                        const BakeJob &job) const;
+    BakeStatistics bake_jobs(const std::vector<BakeJob> &jobs) const;
+    BakeStatistics bake_region(glm::ivec3 region_min, glm::ivec3 region_max,
+                               GLubyte *sdf_bytes, GLubyte *normals_bytes) const;
+    bool refresh_gpu_baker();
+    BakeCacheHeader cache_header(const std::string &scene_description) const;
 
 public:
     Block();
     Block(glm::vec3 origin, float block_size, int nb_texels, float (*sdf)(glm::vec3));
+    Block(glm::vec3 origin, float block_size, int nb_texels, std::shared_ptr<const SdfField> field);
+
+    /** Distances beyond +-max_distance saturate every encoding */
+    static constexpr float max_distance = DistanceEncoding::max_distance;
+
+    /** Version of the bytes written by generate_textures, part of the bake cache keys. Bump
+     * it whenever the encoding of distances or normals changes. */
+    static constexpr uint32_t encoding_version = 2;
+
+    /** Strategy used by the next generate_textures (interval culling by default) */
+    void set_bake_strategy(BakeStrategy strategy);
+
+    /** Encoding mode of the next full bake (fixed by default). The concrete encoding is
+     * chosen from the field when the bake starts. */
+    void set_encoding_mode(EncodingMode mode);
+
+    /** Encoding of the distances in the current textures, to decode them in the shader */
+    DistanceEncoding distance_encoding() const;
+
+    /** Texel format of the distance texture from the next full bake on (r8 by default) */
+    void set_distance_format(DistanceFormat format);
+    DistanceFormat distance_format() const;
+
+    /** Set the distance_format and texel_layout uniforms and the encoding uniforms (see
+     * DistanceEncoding::set_uniforms) of a program in use, to decode the distance texture */
+    void set_distance_uniforms(GLuint program) const;
+
+    /** Texel format of the normal texture from the next full bake on (rgb8 by default). With
+     * none the block keeps no normals and the shader derives them from the distances. */
+    void set_normal_format(NormalFormat format);
+    NormalFormat normal_format() const;
+
+    /** Set the normal_format uniform of a program in use, to decode the normal texture */
+    void set_normal_uniforms(GLuint program) const;
+
+    /** Texel layout from the next full bake on (split by default). Interleaved blocks keep a
+     * single RGBA8 texture, bound to unit 0. With other formats than r8 and rgb8 they are
+     * baked split, with a warning. Chunked volumes are always split. */
+    void set_texel_layout(TexelLayout layout);
+    TexelLayout texel_layout() const;
+
+    /** Replace the field. Only the regions marked dirty are re-baked by update_textures. */
+    void set_field(std::shared_ptr<const SdfField> field);
+
+    /** Mark the texels whose center lies in the world-space box as needing a re-bake */
+    void mark_dirty(glm::vec3 box_min, glm::vec3 box_max);
+
+    /** Bake the whole block into CPU buffers only (x fastest, distances and normals in their
+     * formats, no normal bytes for none, split whatever the layout), without any OpenGL call.
+     * The buffers are resized as needed and the encoding is chosen first, as in
+     * generate_textures. */
+    BakeStatistics bake_bytes(std::vector<GLubyte> &sdf_bytes,
+                              std::vector<GLubyte> &normals_bytes);
 
     void generate_textures();
+
+    /** Bake with a compute shader generated from the brush list, writing straight into the
+     * textures (rgb8 normals in RGBA8) without any CPU copy. Needs a BrushField and an OpenGL 4.3
+     * context with load_compute_functions done, and bakes on the CPU otherwise. Later
+     * update_textures calls re-bake the dirty regions on the GPU too. */
+    void generate_textures_gpu();
+
+    /** Re-bake the dirty regions and upload only them to the existing textures */
+    void update_textures();
+
+    /** Upload the bake cached for this block, encoding mode, formats, layout and
+     * scene_description straight from the mapped entry, or return false on a miss. The entry
+     * also holds the encoding. No CPU copy is kept, so the next update_textures bakes the whole
+     * block again. */
+    bool load_cached(const BakeCache &cache, const std::string &scene_description);
+
+    /** Store the last CPU bake in the cache. Returns false if the textures only live on the
+     * GPU or the entry cannot be written. */
+    bool store_cached(const BakeCache &cache, const std::string &scene_description) const;
+
+    /** Bake the listed chunks of volume and write each one to the file as soon as its batch
+     * is done, without touching the textures. A batch holds at most memory_budget bytes of
+     * texels (and at least one chunk), so memory use does not grow with nb_texels. The volume
+     * must have the placement and resolution of this block, whose encoding and formats become
+     * the ones stored in the volume. Chunk sizes that are multiples of 16 give the same bytes as
+     * generate_textures. */
+    BakeStatistics bake_chunks(const ChunkedVolume &volume, const std::vector<size_t> &chunks,
+                               size_t memory_budget);
+
+    /** Create a chunked volume at path with the encoding chosen for the block and its formats,
+     * and stream the whole block into it, see bake_chunks */
+    BakeStatistics bake_to_file(const std::string &path, int chunk_size, size_t memory_budget);
+
     void bind_textures() const;
+    BakeStatistics bake_statistics() const;
 
     void print_slice(int z) const;
-};
\ No newline at end of file
+};
@@ -0,0 +1,214 @@
+#include <algorithm>
+#include <fstream>
+#include <iostream>
+#include <limits>
+#include <sstream>
+
+#include "brush_field.hpp"
+#include "csg.hpp"
+
+// Brushes per BVH leaf
+static const int leaf_brushes = 4;
+
+glm::vec3 Brush::bounds_min() const {
+    switch (shape) {
+    case BrushShape::sphere:
+        return center - size.x;
+    case BrushShape::box:
+        return center - size;
+    case BrushShape::torus:
+        return center - glm::vec3(size.x + size.y, size.y, size.x + size.y);
+    }
+    return center;
+}
+
+glm::vec3 Brush::bounds_max() const { return 2.0f * center - bounds_min(); }
+
+/** Smooth union of a list of brushes, written once for every scalar type */
+struct BrushKernel {
+    const std::vector<Brush> &brushes;
+    float blend;
+
+    template <typename T> T operator()(T x, T y, T z) const {
+        using std::min;
+        if (brushes.empty()) {
+            return csg::constant_like(x, std::numeric_limits<float>::infinity());
+        }
+        T result = distance(brushes[0], x, y, z);
+        for (size_t i = 1; i < brushes.size(); ++i) {
+            T brush_distance = distance(brushes[i], x, y, z);
+            result = blend > 0.0f ? csg::smooth_min(result, brush_distance, blend)
+                                  : min(result, brush_distance);
+        }
+        return result;
+    }
+
+    template <typename T> static T distance(const Brush &brush, T x, T y, T z) {
+        switch (brush.shape) {
+        case BrushShape::sphere:
+            return csg::sphere(brush.center, brush.size.x)(x, y, z);
+        case BrushShape::box:
+            return csg::box(brush.center, brush.size)(x, y, z);
+        case BrushShape::torus:
+            return csg::torus(brush.center, brush.size.x, brush.size.y)(x, y, z);
+        }
+        return x;
+    }
+};
+
+BrushField::BrushField(std::vector<Brush> brushes, float blend)
+    : brushes(std::move(brushes)), blend(blend) {
+    brush_order.resize(this->brushes.size());
+    for (size_t i = 0; i < brush_order.size(); ++i) {
+        brush_order[i] = static_cast<int>(i);
+    }
+    if (!this->brushes.empty()) {
+        nodes.reserve(2 * this->brushes.size());
+        build(0, static_cast<int>(this->brushes.size()));
+    }
+}
+
+int BrushField::build(int first, int count) {
+    glm::vec3 bounds_min(std::numeric_limits<float>::max());
+    glm::vec3 bounds_max(-std::numeric_limits<float>::max());
+    glm::vec3 centers_min = bounds_min, centers_max = bounds_max;
+    for (int i = first; i < first + count; ++i) {
+        auto &brush = brushes[brush_order[i]];
+        bounds_min = glm::min(bounds_min, brush.bounds_min());
+        bounds_max = glm::max(bounds_max, brush.bounds_max());
+        centers_min = glm::min(centers_min, brush.center);
+        centers_max = glm::max(centers_max, brush.center);
+    }
+
+    int index = static_cast<int>(nodes.size());
+    nodes.push_back({bounds_min, bounds_max, first, count});
+    if (count <= leaf_brushes) {
+        return index;
+    }
+
+    // Median split along the axis where the centers spread the most
+    auto spread = centers_max - centers_min;
+    int axis = spread.x > spread.y ? (spread.x > spread.z ? 0 : 2) : (spread.y > spread.z ? 1 : 2);
+    auto begin = brush_order.begin() + first;
+    std::nth_element(begin, begin + count / 2, begin + count, [&](int a, int b) {
+        return brushes[a].center[axis] < brushes[b].center[axis];
+    });
+
+    // The left child is stored right after its parent, the right one after the left subtree
+    build(first, count / 2);
+    int right = build(first + count / 2, count - count / 2);
+    nodes[index].first = right;
+    nodes[index].count = 0;
+    return index;
+}
+
+std::shared_ptr<BrushField> BrushField::load(const std::string &path) {
+    std::ifstream stream(path);
+    if (!stream.is_open()) {
+        std::cerr << "\n\nError: cannot open file [" << path << "]" << std::endl;
+        abort();
+    }
+
+    std::vector<Brush> brushes;
+    float blend = 0.0f;
+    std::string line;
+    int line_number = 0;
+    while (std::getline(stream, line)) {
+        ++line_number;
+        std::istringstream words(line);
+        std::string name;
+        if (!(words >> name) || name[0] == '#') {
+            continue;
+        }
+        if (name == "blend") {
+            if (!(words >> blend)) {
+                std::cerr << "Error: [blend] at line " << line_number << " of [" << path
+                          << "] needs a radius" << std::endl;
+                abort();
+            }
+            continue;
+        }
+        Brush brush{BrushShape::sphere, glm::vec3(0.0f), glm::vec3(0.0f)};
+        bool valid = static_cast<bool>(words >> brush.center.x >> brush.center.y >> brush.center.z);
+        if (name == "sphere") {
+            valid = valid && words >> brush.size.x;
+        } else if (name == "box") {
+            brush.shape = BrushShape::box;
+            valid = valid && words >> brush.size.x >> brush.size.y >> brush.size.z;
+        } else if (name == "torus") {
+            brush.shape = BrushShape::torus;
+            valid = valid && words >> brush.size.x >> brush.size.y;
+        } else {
+            std::cerr << "Error: unknown brush [" << name << "] at line " << line_number << " of ["
+                      << path << "]" << std::endl;
+            abort();
+        }
+        if (!valid) {
+            std::cerr << "Error: brush [" << name << "] at line " << line_number << " of [" << path
+                      << "] is missing parameters" << std::endl;
+            abort();
+        }
+        brushes.push_back(brush);
+    }
+    return std::make_shared<BrushField>(std::move(brushes), blend);
+}
+
+const std::vector<Brush> &BrushField::brush_list() const { return brushes; }
+
+float BrushField::blend_radius() const { return blend; }
+
+void BrushField::evaluate(PositionSpan positions, float *distances) const {
+    for_each_batch(positions.x, positions.y, positions.z, distances, positions.count,
+                   BrushKernel{brushes, blend});
+}
+
+void BrushField::evaluate_gradient(PositionSpan positions, float *distances, float *gradient_x,
+                                   float *gradient_y, float *gradient_z) const {
+    for_each_batch_gradient(positions.x, positions.y, positions.z, distances, gradient_x,
+                            gradient_y, gradient_z, positions.count, BrushKernel{brushes, blend});
+}
+
+Interval BrushField::evaluate_interval(glm::vec3 box_min, glm::vec3 box_max) const {
+    return BrushKernel{brushes, blend}(Interval{box_min.x, box_max.x},
+                                       Interval{box_min.y, box_max.y},
+                                       Interval{box_min.z, box_max.z});
+}
+
+std::shared_ptr<const SdfField> BrushField::restrict_to(glm::vec3 box_min, glm::vec3 box_max,
+                                                        float reach) const {
+    // A brush farther than reach + 2 * blend either leaves the smooth union unchanged or only
+    // lowers distances that are already above reach + blend / 2
+    auto margin = glm::vec3(reach + 2.0f * blend);
+    box_min -= margin;
+    box_max += margin;
+    std::vector<int> selected;
+    std::vector<int> stack;
+    if (!nodes.empty()) {
+        stack.push_back(0);
+    }
+    while (!stack.empty()) {
+        int index = stack.back();
+        auto &node = nodes[index];
+        stack.pop_back();
+        if (glm::any(glm::lessThan(node.bounds_max, box_min)) ||
+            glm::any(glm::greaterThan(node.bounds_min, box_max))) {
+            continue;
+        }
+        if (node.count == 0) {
+            stack.push_back(index + 1);
+            stack.push_back(node.first);
+            continue;
+        }
+        selected.insert(selected.end(), brush_order.begin() + node.first,
+                        brush_order.begin() + node.first + node.count);
+    }
+
+    // Keep the scene order, so smooth blends are chained exactly as in the full scene
+    std::sort(selected.begin(), selected.end());
+    std::vector<Brush> local_brushes;
+    local_brushes.reserve(selected.size());
+    for (int i : selected) {
+        local_brushes.push_back(brushes[i]);
+    }
+    return std::make_shared<BrushField>(std::move(local_brushes), blend);
+}
@@ -0,0 +1,62 @@
+#pragma once
+
+#include <memory>
+#include <string>
+#include <vector>
+
+#include <glm/glm.hpp>
+
+#include "sdf_field.hpp"
+
+enum class BrushShape { sphere, box, torus };
+
+/** Primitive of a brush scene. size holds the radius of a sphere in x, the half size of a
+ * box, and the major and minor radii of a torus in x and y. */
+struct Brush {
+    BrushShape shape;
+    glm::vec3 center;
+    glm::vec3 size;
+
+    glm::vec3 bounds_min() const;
+    glm::vec3 bounds_max() const;
+};
+
+/** Smooth union of many brushes (a hard union when blend is 0).
+ * A bounding-volume hierarchy over the brush bounds lets restrict_to keep only the brushes
+ * that can bring the distance below reach inside a region. The block passes the saturation
+ * distance of the encoding it bakes, so the codes do not change while each brick only
+ * evaluates the brushes close to it, and narrower encodings such as voxel_band cull more. */
+class BrushField : public SdfField {
+private:
+    struct Node {
+        glm::vec3 bounds_min;
+        glm::vec3 bounds_max;
+        int first; // Right child for inner nodes (the left one follows the node), first
+                   // position in brush_order for leaves
+        int count; // Number of brushes in a leaf, 0 for inner nodes
+    };
+
+    std::vector<Brush> brushes;
+    float blend;
+    std::vector<Node> nodes;
+    std::vector<int> brush_order;
+
+    int build(int first, int count);
+
+public:
+    BrushField(std::vector<Brush> brushes, float blend);
+
+    /** Read a brush scene: one "sphere x y z radius", "box x y z half_x half_y half_z" or
+     * "torus x y z major minor" per line, an optional "blend k" line, and # comments */
+    static std::shared_ptr<BrushField> load(const std::string &path);
+
+    const std::vector<Brush> &brush_list() const;
+    float blend_radius() const;
+
+    void evaluate(PositionSpan positions, float *distances) const override;
+    void evaluate_gradient(PositionSpan positions, float *distances, float *gradient_x,
+                           float *gradient_y, float *gradient_z) const override;
+    Interval evaluate_interval(glm::vec3 box_min, glm::vec3 box_max) const override;
+    std::shared_ptr<const SdfField> restrict_to(glm::vec3 box_min, glm::vec3 box_max,
+                                                float reach) const override;
+};
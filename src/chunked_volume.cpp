@@ -0,0 +1,134 @@
+#include <cstdlib>
+#include <cstring>
+#include <filesystem>
+#include <fstream>
+#include <iostream>
+
+#include "chunked_volume.hpp"
+
+static const char chunked_volume_magic[8] = "SDFCHNK";
+
+ChunkedVolume ChunkedVolume::create(const std::string &path, glm::vec3 origin, float block_size,
+                                    int nb_texels, int chunk_size, uint32_t encoding_version,
+                                    const DistanceEncoding &distance_encoding,
+                                    DistanceFormat distance_format,
+                                    NormalFormat normal_format) {
+    ChunkedVolume volume;
+    volume.path = path;
+    std::memset(&volume.header, 0, sizeof(ChunkedVolumeHeader));
+    std::memcpy(volume.header.magic, chunked_volume_magic, 8);
+    volume.header.encoding_version = encoding_version;
+    volume.header.nb_texels = nb_texels;
+    volume.header.chunk_size = chunk_size;
+    volume.header.origin[0] = origin.x;
+    volume.header.origin[1] = origin.y;
+    volume.header.origin[2] = origin.z;
+    volume.header.block_size = block_size;
+    volume.header.distance_encoding = distance_encoding;
+    volume.header.distance_format = static_cast<int32_t>(distance_format);
+    volume.header.normal_format = static_cast<int32_t>(normal_format);
+
+    std::ofstream stream(path, std::ios::binary | std::ios::trunc);
+    stream.write(reinterpret_cast<const char *>(&volume.header), sizeof(ChunkedVolumeHeader));
+    stream.close();
+    // Extend the file without writing the chunks, most file systems keep it sparse
+    std::error_code error;
+    std::filesystem::resize_file(
+        path, sizeof(ChunkedVolumeHeader) + volume.chunk_count() * volume.chunk_bytes(), error);
+    if (!stream || error) {
+        std::cerr << "Error: cannot create chunked volume " << path << std::endl;
+        abort();
+    }
+    return volume;
+}
+
+ChunkedVolume ChunkedVolume::open(const std::string &path) {
+    ChunkedVolume volume;
+    volume.path = path;
+    std::ifstream stream(path, std::ios::binary);
+    stream.read(reinterpret_cast<char *>(&volume.header), sizeof(ChunkedVolumeHeader));
+    if (!stream || std::memcmp(volume.header.magic, chunked_volume_magic, 8) != 0 ||
+        volume.header.nb_texels <= 0 || volume.header.chunk_size <= 0 ||
+        volume.header.distance_format < 0 || volume.header.distance_format > 3 ||
+        volume.header.normal_format < 0 || volume.header.normal_format > 3) {
+        std::cerr << "Error: " << path << " is not a chunked volume" << std::endl;
+        abort();
+    }
+    return volume;
+}
+
+glm::vec3 ChunkedVolume::origin() const {
+    return glm::vec3(header.origin[0], header.origin[1], header.origin[2]);
+}
+
+float ChunkedVolume::block_size() const { return header.block_size; }
+
+int ChunkedVolume::nb_texels() const { return header.nb_texels; }
+
+int ChunkedVolume::chunk_size() const { return header.chunk_size; }
+
+uint32_t ChunkedVolume::encoding_version() const { return header.encoding_version; }
+
+DistanceEncoding ChunkedVolume::distance_encoding() const { return header.distance_encoding; }
+
+DistanceFormat ChunkedVolume::distance_format() const {
+    return static_cast<DistanceFormat>(header.distance_format);
+}
+
+NormalFormat ChunkedVolume::normal_format() const {
+    return static_cast<NormalFormat>(header.normal_format);
+}
+
+int ChunkedVolume::chunks_per_axis() const {
+    return (header.nb_texels + header.chunk_size - 1) / header.chunk_size;
+}
+
+size_t ChunkedVolume::chunk_count() const {
+    size_t nb_chunks = chunks_per_axis();
+    return nb_chunks * nb_chunks * nb_chunks;
+}
+
+size_t ChunkedVolume::chunk_texels() const {
+    size_t size = header.chunk_size;
+    return size * size * size;
+}
+
+size_t ChunkedVolume::chunk_bytes() const {
+    return (distance_texel_bytes(distance_format()) + normal_texel_bytes(normal_format())) *
+           chunk_texels();
+}
+
+glm::ivec3 ChunkedVolume::chunk_min(size_t index) const {
+    size_t nb_chunks = chunks_per_axis();
+    return glm::ivec3(index % nb_chunks, (index / nb_chunks) % nb_chunks,
+                      index / (nb_chunks * nb_chunks)) *
+           header.chunk_size;
+}
+
+void ChunkedVolume::write_chunk(size_t index, const unsigned char *sdf_bytes,
+                                const unsigned char *normals_bytes) const {
+    // Opened without truncation, other writers may be filling other chunks
+    std::fstream stream(path, std::ios::binary | std::ios::in | std::ios::out);
+    stream.seekp(sizeof(ChunkedVolumeHeader) + index * chunk_bytes());
+    size_t sdf_bytes_count = distance_texel_bytes(distance_format()) * chunk_texels();
+    stream.write(reinterpret_cast<const char *>(sdf_bytes), sdf_bytes_count);
+    stream.write(reinterpret_cast<const char *>(normals_bytes), chunk_bytes() - sdf_bytes_count);
+    stream.close();
+    if (!stream) {
+        std::cerr << "Error: cannot write chunk " << index << " of " << path << std::endl;
+        abort();
+    }
+}
+
+void ChunkedVolume::read_chunk(size_t index, unsigned char *sdf_bytes,
+                               unsigned char *normals_bytes) const {
+    std::ifstream stream(path, std::ios::binary);
+    stream.seekg(sizeof(ChunkedVolumeHeader) + index * chunk_bytes());
+    size_t sdf_bytes_count = distance_texel_bytes(distance_format()) * chunk_texels();
+    stream.read(reinterpret_cast<char *>(sdf_bytes), sdf_bytes_count);
+    stream.read(reinterpret_cast<char *>(normals_bytes), chunk_bytes() - sdf_bytes_count);
+    if (!stream) {
+        std::cerr << "Error: cannot read chunk " << index << " of " << path << std::endl;
+        abort();
+    }
+}
@@ -0,0 +1,73 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <glm/glm.hpp>
+#include <string>
+
+#include "distance_encoding.hpp"
+#include "normal_encoding.hpp"
+
+// Baked volume stored on disk as cubic chunks of chunk_size^3 texels, for volumes too large to
+// hold in memory. Chunk i (x fastest) sits at a fixed offset: the chunk_size^3 distance texels
+// followed by the chunk_size^3 normal texels, in x-fastest order within the chunk. Chunks
+// crossing the end of the volume are padded to the full size. Since every chunk has its own
+// bytes, any number of writers can fill disjoint chunks of the same file without locking.
+
+/** Fixed-size header at the start of the file, with the encoding of the distance codes and the
+ * texel formats */
+struct ChunkedVolumeHeader {
+    char magic[8];
+    uint32_t encoding_version;
+    int32_t nb_texels;
+    int32_t chunk_size;
+    float origin[3];
+    float block_size;
+    DistanceEncoding distance_encoding;
+    int32_t distance_format;
+    int32_t normal_format;
+};
+
+class ChunkedVolume {
+private:
+    std::string path;
+    ChunkedVolumeHeader header;
+
+public:
+    /** Create the file at path, sized for the whole volume. Chunks that are never written read
+     * as zeros. Prints an error and aborts if the file cannot be created. */
+    static ChunkedVolume create(const std::string &path, glm::vec3 origin, float block_size,
+                                int nb_texels, int chunk_size, uint32_t encoding_version,
+                                const DistanceEncoding &distance_encoding,
+                                DistanceFormat distance_format, NormalFormat normal_format);
+
+    /** Open an existing file. Prints an error and aborts if it is not a chunked volume. */
+    static ChunkedVolume open(const std::string &path);
+
+    glm::vec3 origin() const;
+    float block_size() const;
+    int nb_texels() const;
+    int chunk_size() const;
+    uint32_t encoding_version() const;
+    DistanceEncoding distance_encoding() const;
+    DistanceFormat distance_format() const;
+    NormalFormat normal_format() const;
+
+    /** Number of chunks along each axis, and in total */
+    int chunks_per_axis() const;
+    size_t chunk_count() const;
+
+    /** Texels of one chunk, and its bytes: distances then normals */
+    size_t chunk_texels() const;
+    size_t chunk_bytes() const;
+
+    /** First texel of chunk index */
+    glm::ivec3 chunk_min(size_t index) const;
+
+    /** Write the chunk_size^3 distance texels and normal texels of a chunk */
+    void write_chunk(size_t index, const unsigned char *sdf_bytes,
+                     const unsigned char *normals_bytes) const;
+
+    /** Read the distance texels and normal texels of a chunk */
+    void read_chunk(size_t index, unsigned char *sdf_bytes, unsigned char *normals_bytes) const;
+};
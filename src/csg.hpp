@@ -0,0 +1,178 @@
+#pragma once
+
+#include <algorithm>
+#include <cmath>
+#include <memory>
+
+#include <glm/glm.hpp>
+
+#include "dual.hpp"
+#include "interval.hpp"
+#include "sdf_field.hpp"
+#include "simd.hpp"
+
+// Compile-time CSG scenes. Every node is a small value type whose call operator is templated
+// on the scalar type, so a whole scene such as
+//     auto scene = csg::smooth_unite(csg::sphere(c, 0.3f), csg::box(c, glm::vec3(0.2f)), 0.1f);
+// is one type that the compiler inlines into a single kernel. The same kernel runs on floats,
+// FloatBatch lanes, dual numbers and intervals, and csg::make_field turns it into an SdfField
+// that Block can bake.
+
+namespace csg {
+
+// Constant of the same scalar type as x
+inline float constant_like(float, float value) { return value; }
+inline FloatBatch constant_like(FloatBatch, float value) { return FloatBatch::broadcast(value); }
+inline Interval constant_like(Interval, float value) { return {value, value}; }
+template <typename T> Dual<T> constant_like(const Dual<T> &, float value) {
+    auto zero = splat<T>(0.0f);
+    return {splat<T>(value), zero, zero, zero};
+}
+
+template <typename T> T length(T x, T y, T z) {
+    using std::sqrt;
+    return sqrt(x * x + y * y + z * z);
+}
+
+/** Polynomial smooth minimum with blend radius k. Written around min(a, b) so that it gives
+ * exactly min(a, b) once a and b are more than k apart. */
+template <typename T> T smooth_min(T a, T b, float k) {
+    using std::abs;
+    using std::max;
+    using std::min;
+    auto h = max(k - abs(a - b), constant_like(a, 0.0f)) * (1.0f / k);
+    return min(a, b) - h * h * (0.25f * k);
+}
+
+// ************************************ //
+//          Primitives
+// ************************************ //
+
+struct Sphere {
+    glm::vec3 center;
+    float radius;
+
+    template <typename T> T operator()(T x, T y, T z) const {
+        return length(x - center.x, y - center.y, z - center.z) - radius;
+    }
+};
+
+struct Box {
+    glm::vec3 center;
+    glm::vec3 half_size;
+
+    template <typename T> T operator()(T x, T y, T z) const {
+        using std::abs;
+        using std::max;
+        using std::min;
+        auto qx = abs(x - center.x) - half_size.x;
+        auto qy = abs(y - center.y) - half_size.y;
+        auto qz = abs(z - center.z) - half_size.z;
+        auto zero = constant_like(qx, 0.0f);
+        auto outside = length(max(qx, zero), max(qy, zero), max(qz, zero));
+        auto inside = min(max(qx, max(qy, qz)), zero);
+        return outside + inside;
+    }
+};
+
+/** Torus around the y axis */
+struct Torus {
+    glm::vec3 center;
+    float major_radius;
+    float minor_radius;
+
+    template <typename T> T operator()(T x, T y, T z) const {
+        using std::sqrt;
+        auto dx = x - center.x;
+        auto dz = z - center.z;
+        auto ring = sqrt(dx * dx + dz * dz) - major_radius;
+        auto dy = y - center.y;
+        return sqrt(ring * ring + dy * dy) - minor_radius;
+    }
+};
+
+// ************************************ //
+//          Operators
+// ************************************ //
+
+template <typename A> struct Translate {
+    A child;
+    glm::vec3 offset;
+
+    template <typename T> T operator()(T x, T y, T z) const {
+        return child(x - offset.x, y - offset.y, z - offset.z);
+    }
+};
+
+template <typename A, typename B> struct Union {
+    A left;
+    B right;
+
+    template <typename T> T operator()(T x, T y, T z) const {
+        using std::min;
+        return min(left(x, y, z), right(x, y, z));
+    }
+};
+
+template <typename A, typename B> struct Intersection {
+    A left;
+    B right;
+
+    template <typename T> T operator()(T x, T y, T z) const {
+        using std::max;
+        return max(left(x, y, z), right(x, y, z));
+    }
+};
+
+template <typename A, typename B> struct Difference {
+    A left;
+    B right;
+
+    template <typename T> T operator()(T x, T y, T z) const {
+        using std::max;
+        return max(left(x, y, z), -right(x, y, z));
+    }
+};
+
+template <typename A, typename B> struct SmoothUnion {
+    A left;
+    B right;
+    float k;
+
+    template <typename T> T operator()(T x, T y, T z) const {
+        return smooth_min(left(x, y, z), right(x, y, z), k);
+    }
+};
+
+// ************************************ //
+//          Builders
+// ************************************ //
+
+inline Sphere sphere(glm::vec3 center, float radius) { return {center, radius}; }
+inline Box box(glm::vec3 center, glm::vec3 half_size) { return {center, half_size}; }
+inline Torus torus(glm::vec3 center, float major_radius, float minor_radius) {
+    return {center, major_radius, minor_radius};
+}
+
+template <typename A> Translate<A> translate(A child, glm::vec3 offset) { return {child, offset}; }
+
+template <typename A, typename B> Union<A, B> unite(A left, B right) { return {left, right}; }
+template <typename A, typename B, typename... Rest> auto unite(A left, B right, Rest... rest) {
+    return unite(Union<A, B>{left, right}, rest...);
+}
+template <typename A, typename B> Intersection<A, B> intersect(A left, B right) {
+    return {left, right};
+}
+template <typename A, typename B> Difference<A, B> subtract(A left, B right) {
+    return {left, right};
+}
+template <typename A, typename B> SmoothUnion<A, B> smooth_unite(A left, B right, float k) {
+    return {left, right, k};
+}
+
+/** SdfField evaluating the fused scene kernel */
+template <typename Expression> std::shared_ptr<const SdfField> make_field(Expression scene) {
+    return std::make_shared<KernelField<Expression>>(scene);
+}
+
+} // namespace csg
@@ -0,0 +1,320 @@
+#include <cstdint>
+#include <cstdio>
+#include <cstdlib>
+#include <filesystem>
+#include <fstream>
+#include <iomanip>
+#include <iostream>
+#include <iterator>
+#include <sstream>
+#include <vector>
+
+#ifndef _WIN32
+#include <dlfcn.h>
+#include <unistd.h>
+#endif
+
+#include "csg_jit.hpp"
+#include "process.hpp"
+
+// Root of the source tree, to find csg.hpp and glm when compiling modules
+#ifndef SDF_JIT_SOURCE_DIR
+#define SDF_JIT_SOURCE_DIR "."
+#endif
+
+// Exact float literal
+static std::string literal(float value) {
+    std::ostringstream stream;
+    stream << std::hexfloat << value << 'f';
+    return stream.str();
+}
+
+static std::string vec3_literal(const float *p) {
+    return "glm::vec3(" + literal(p[0]) + ", " + literal(p[1]) + ", " + literal(p[2]) + ")";
+}
+
+std::string generate_jit_source(const CsgProgram &program) {
+    std::ostringstream body;
+    std::vector<std::string> values;
+    std::vector<std::string> frames = {"0"};
+    std::vector<float> frame_scales = {1.0f};
+    int nb_variables = 0;
+
+    auto position = [&](const std::string &frame) {
+        return "(x" + frame + ", y" + frame + ", z" + frame + ")";
+    };
+    auto new_value = [&](const std::string &expression) {
+        auto name = "v" + std::to_string(nb_variables++);
+        body << "        auto " << name << " = " << expression << ";\n";
+        values.push_back(name);
+    };
+    auto pop_value = [&]() {
+        auto name = values.back();
+        values.pop_back();
+        return name;
+    };
+
+    auto &constants = program.parameters();
+    for (auto &instruction : program.code()) {
+        const float *p = constants.data() + instruction.operand;
+        auto &frame = frames.back();
+        switch (instruction.opcode) {
+        case Opcode::sphere:
+            new_value("csg::sphere(" + vec3_literal(p) + ", " + literal(p[3]) + ")" +
+                      position(frame));
+            break;
+        case Opcode::box:
+            new_value("csg::box(" + vec3_literal(p) + ", " + vec3_literal(p + 3) + ")" +
+                      position(frame));
+            break;
+        case Opcode::torus:
+            new_value("csg::torus(" + vec3_literal(p) + ", " + literal(p[3]) + ", " +
+                      literal(p[4]) + ")" + position(frame));
+            break;
+        case Opcode::translate:
+        case Opcode::scale: {
+            bool translation = instruction.opcode == Opcode::translate;
+            auto next = std::to_string(frames.size());
+            const char *axes[3] = {"x", "y", "z"};
+            for (int axis = 0; axis < 3; ++axis) {
+                body << "        auto " << axes[axis] << next << " = " << axes[axis] << frame
+                     << (translation ? " - " + literal(p[axis]) : " / " + literal(p[0]))
+                     << ";\n";
+            }
+            frames.push_back(next);
+            frame_scales.push_back(translation ? 1.0f : p[0]);
+            break;
+        }
+        case Opcode::pop_transform:
+            if (frame_scales.back() != 1.0f) {
+                new_value(pop_value() + " * " + literal(frame_scales.back()));
+            }
+            frames.pop_back();
+            frame_scales.pop_back();
+            break;
+        case Opcode::unite: {
+            auto right = pop_value();
+            new_value("min(" + pop_value() + ", " + right + ")");
+            break;
+        }
+        case Opcode::intersect: {
+            auto right = pop_value();
+            new_value("max(" + pop_value() + ", " + right + ")");
+            break;
+        }
+        case Opcode::subtract: {
+            auto right = pop_value();
+            new_value("max(" + pop_value() + ", -" + right + ")");
+            break;
+        }
+        case Opcode::smooth_unite: {
+            auto right = pop_value();
+            new_value("csg::smooth_min(" + pop_value() + ", " + right + ", " + literal(p[0]) +
+                      ")");
+            break;
+        }
+        }
+    }
+
+    std::ostringstream source;
+    source << "// Generated from a CSG program by csg_jit.cpp\n"
+              "#include \"csg.hpp\"\n\n"
+              "struct Scene {\n"
+              "    template <typename T> T operator()(T x0, T y0, T z0) const {\n"
+              "        using std::max;\n"
+              "        using std::min;\n"
+           << body.str() << "        return " << values.back()
+           << ";\n"
+              "    }\n"
+              "};\n\n"
+              "extern \"C\" {\n"
+              "void sdf_evaluate(const float *x, const float *y, const float *z, float *out,\n"
+              "                  size_t count) {\n"
+              "    for_each_batch(x, y, z, out, count, Scene{});\n"
+              "}\n\n"
+              "void sdf_evaluate_gradient(const float *x, const float *y, const float *z,\n"
+              "                           float *out, float *gx, float *gy, float *gz,\n"
+              "                           size_t count) {\n"
+              "    for_each_batch_gradient(x, y, z, out, gx, gy, gz, count, Scene{});\n"
+              "}\n\n"
+              "void sdf_evaluate_interval(const float *box_min, const float *box_max,\n"
+              "                           float *bounds) {\n"
+              "    auto result = Scene{}(Interval{box_min[0], box_max[0]},\n"
+              "                          Interval{box_min[1], box_max[1]},\n"
+              "                          Interval{box_min[2], box_max[2]});\n"
+              "    bounds[0] = result.lower;\n"
+              "    bounds[1] = result.upper;\n"
+              "}\n"
+              "}\n";
+    return source.str();
+}
+
+// ************************************ //
+//          Module loading
+// ************************************ //
+
+std::shared_ptr<const JitField> JitField::load(const std::string &path) {
+#ifdef _WIN32
+    (void)path;
+    return nullptr;
+#else
+    void *handle = dlopen(path.c_str(), RTLD_NOW | RTLD_LOCAL);
+    if (handle == nullptr) {
+        std::cerr << "Warning: cannot load SDF module [" << path << "]: " << dlerror()
+                  << std::endl;
+        return nullptr;
+    }
+    auto field = std::make_shared<JitField>();
+    field->module = std::shared_ptr<void>(handle, [](void *handle) { dlclose(handle); });
+    field->evaluate_function = reinterpret_cast<Evaluate>(dlsym(handle, "sdf_evaluate"));
+    field->evaluate_gradient_function =
+        reinterpret_cast<EvaluateGradient>(dlsym(handle, "sdf_evaluate_gradient"));
+    field->evaluate_interval_function =
+        reinterpret_cast<EvaluateInterval>(dlsym(handle, "sdf_evaluate_interval"));
+    if (!field->evaluate_function || !field->evaluate_gradient_function ||
+        !field->evaluate_interval_function) {
+        std::cerr << "Warning: SDF module [" << path << "] misses its entry points" << std::endl;
+        return nullptr;
+    }
+    return field;
+#endif
+}
+
+void JitField::evaluate(PositionSpan positions, float *distances) const {
+    evaluate_function(positions.x, positions.y, positions.z, distances, positions.count);
+}
+
+void JitField::evaluate_gradient(PositionSpan positions, float *distances, float *gradient_x,
+                                 float *gradient_y, float *gradient_z) const {
+    evaluate_gradient_function(positions.x, positions.y, positions.z, distances, gradient_x,
+                               gradient_y, gradient_z, positions.count);
+}
+
+Interval JitField::evaluate_interval(glm::vec3 box_min, glm::vec3 box_max) const {
+    float bounds[2];
+    evaluate_interval_function(&box_min.x, &box_max.x, bounds);
+    return {bounds[0], bounds[1]};
+}
+
+// ************************************ //
+//          Compilation and cache
+// ************************************ //
+
+// 64-bit FNV-1a
+static uint64_t hash_text(const std::string &text) {
+    uint64_t hash = 14695981039346656037ull;
+    for (unsigned char c : text) {
+        hash = (hash ^ c) * 1099511628211ull;
+    }
+    return hash;
+}
+
+#ifndef _WIN32
+// Arguments separated by spaces, for the cache key and messages
+static std::string join(const std::vector<std::string> &arguments) {
+    std::string joined;
+    for (auto &argument : arguments) {
+        joined += (joined.empty() ? "" : " ") + argument;
+    }
+    return joined;
+}
+
+// Model and instruction set extensions of the host CPU, empty if they cannot be read
+static std::string host_cpu() {
+    std::ifstream stream("/proc/cpuinfo");
+    std::string line, model, flags;
+    while (std::getline(stream, line) && (model.empty() || flags.empty())) {
+        if (model.empty() && line.rfind("model name", 0) == 0) {
+            model = line;
+        } else if (flags.empty() && line.rfind("flags", 0) == 0) {
+            flags = line;
+        }
+    }
+    return flags.empty() ? std::string() : model + '\n' + flags;
+}
+#endif
+
+std::shared_ptr<const SdfField> compile_program(const CsgProgram &program,
+                                                const std::string &cache_directory) {
+    auto fallback = [&]() {
+        std::cerr << "Warning: falling back to the CSG interpreter" << std::endl;
+        return std::make_shared<ProgramField>(program);
+    };
+
+#ifdef _WIN32
+    (void)cache_directory;
+    return fallback();
+#else
+    namespace fs = std::filesystem;
+    fs::path directory = cache_directory;
+    if (directory.empty()) {
+        const char *environment = std::getenv("SDF_JIT_CACHE");
+        directory = environment ? environment : "sdf_jit_cache";
+    }
+    // $CXX may hold a launcher and flags, split on whitespace as make does without quotes
+    std::vector<std::string> compile_command;
+    std::istringstream compiler(std::getenv("CXX") ? std::getenv("CXX") : "");
+    for (std::string word; compiler >> word;) {
+        compile_command.push_back(word);
+    }
+    if (compile_command.empty()) {
+        compile_command.push_back("c++");
+    }
+    std::string source = generate_jit_source(program);
+    // Modules built for the host CPU are keyed by it, the cache directory may be shared by
+    // several machines. Without a way to tell the CPU, modules target the compiler default.
+    std::string cpu = host_cpu();
+    compile_command.insert(compile_command.end(), {"-std=c++17", "-O2"});
+    if (!cpu.empty()) {
+        compile_command.push_back("-march=native");
+    }
+    compile_command.insert(compile_command.end(),
+                           {"-shared", "-fPIC", "-I" SDF_JIT_SOURCE_DIR "/src",
+                            "-I" SDF_JIT_SOURCE_DIR "/includes/glm"});
+
+    // The key covers everything that ends up in the module, including the headers it uses
+    std::string headers;
+    for (auto header : {"csg.hpp", "sdf_field.hpp", "simd.hpp", "dual.hpp", "interval.hpp"}) {
+        std::ifstream stream(fs::path(SDF_JIT_SOURCE_DIR) / "src" / header);
+        headers += std::string(std::istreambuf_iterator<char>(stream), {});
+    }
+    std::ostringstream key;
+    key << std::hex << std::setw(16) << std::setfill('0')
+        << hash_text(source + headers + join(compile_command) + cpu);
+    fs::path module_path = directory / (key.str() + ".so");
+
+    if (!fs::exists(module_path)) {
+        std::error_code error;
+        fs::create_directories(directory, error);
+
+        // Write and compile to private names and rename, so concurrent runs never compile or
+        // load a partial file
+        std::string pid = std::to_string(getpid());
+        fs::path source_path = directory / (key.str() + ".tmp" + pid + ".cpp");
+        std::ofstream(source_path) << source;
+        fs::path temporary_path = directory / (key.str() + ".so.tmp" + pid);
+        compile_command.insert(compile_command.end(),
+                               {source_path.string(), "-o", temporary_path.string()});
+        std::cout << "Compiling SDF module " << module_path << std::endl;
+        bool compiled = run_process(compile_command);
+        fs::remove(source_path, error);
+        if (!compiled) {
+            std::cerr << "Warning: SDF module compilation failed: " << join(compile_command)
+                      << std::endl;
+            fs::remove(temporary_path, error);
+            return fallback();
+        }
+        fs::rename(temporary_path, module_path, error);
+        if (error) {
+            std::cerr << "Warning: cannot store SDF module " << module_path << std::endl;
+            return fallback();
+        }
+    }
+
+    auto field = JitField::load(module_path.string());
+    if (!field) {
+        return fallback();
+    }
+    return field;
+#endif
+}
@@ -0,0 +1,45 @@
+#pragma once
+
+#include <memory>
+#include <string>
+
+#include "csg_program.hpp"
+#include "sdf_field.hpp"
+
+// Native compilation of CSG programs. The program is turned into straight-line C++ built on
+// the csg.hpp kernels, compiled by the system compiler into a shared object and loaded with
+// dlopen. Modules are cached on disk under a hash of their source, compile command and host
+// CPU, so later runs with the same scene only pay for dlopen.
+
+/** C++ source of a shared object exporting the program as sdf_evaluate,
+ * sdf_evaluate_gradient and sdf_evaluate_interval */
+std::string generate_jit_source(const CsgProgram &program);
+
+/** SdfField calling into a compiled module */
+class JitField : public SdfField {
+private:
+    using Evaluate = void (*)(const float *, const float *, const float *, float *, size_t);
+    using EvaluateGradient = void (*)(const float *, const float *, const float *, float *,
+                                      float *, float *, float *, size_t);
+    using EvaluateInterval = void (*)(const float *, const float *, float *);
+
+    std::shared_ptr<void> module;
+    Evaluate evaluate_function;
+    EvaluateGradient evaluate_gradient_function;
+    EvaluateInterval evaluate_interval_function;
+
+public:
+    /** Load the module at path, or return nullptr if it cannot be loaded */
+    static std::shared_ptr<const JitField> load(const std::string &path);
+
+    void evaluate(PositionSpan positions, float *distances) const override;
+    void evaluate_gradient(PositionSpan positions, float *distances, float *gradient_x,
+                           float *gradient_y, float *gradient_z) const override;
+    Interval evaluate_interval(glm::vec3 box_min, glm::vec3 box_max) const override;
+};
+
+/** Compile the program (or reuse the cached module) and return a JitField. When no compiler
+ * is available or compilation fails, print a warning and fall back to a ProgramField.
+ * The cache directory defaults to $SDF_JIT_CACHE, then to sdf_jit_cache. */
+std::shared_ptr<const SdfField> compile_program(const CsgProgram &program,
+                                                const std::string &cache_directory = "");
@@ -0,0 +1,425 @@
+#include <algorithm>
+#include <fstream>
+#include <iostream>
+#include <sstream>
+
+#include "csg.hpp"
+#include "csg_program.hpp"
+
+struct OpcodeInfo {
+    Opcode opcode;
+    const char *name;
+    int nb_parameters;
+};
+
+static const OpcodeInfo opcode_infos[] = {
+    {Opcode::sphere, "sphere", 4},       {Opcode::box, "box", 6},
+    {Opcode::torus, "torus", 5},         {Opcode::translate, "translate", 3},
+    {Opcode::scale, "scale", 1},         {Opcode::pop_transform, "pop", 0},
+    {Opcode::unite, "union", 0},         {Opcode::intersect, "intersection", 0},
+    {Opcode::subtract, "difference", 0}, {Opcode::smooth_unite, "smooth_union", 1},
+};
+
+static const OpcodeInfo &info_of(Opcode opcode) {
+    return opcode_infos[static_cast<int>(opcode)];
+}
+
+// ************************************ //
+//          Program building
+// ************************************ //
+
+CsgProgram::CsgProgram() : value_depth{0}, max_value_depth{0}, max_transform_depth{0} {}
+
+void CsgProgram::emit(Opcode opcode, std::initializer_list<float> parameters) {
+    instructions.push_back({opcode, static_cast<uint32_t>(constants.size())});
+    constants.insert(constants.end(), parameters);
+}
+
+void CsgProgram::pop_values(int count, const char *opcode_name) {
+    int floor = transform_stack.empty() ? 0 : transform_stack.back();
+    if (value_depth - count < floor) {
+        std::cerr << "Error: CSG instruction [" << opcode_name << "] needs " << count
+                  << " distances on the stack" << std::endl;
+        abort();
+    }
+    value_depth -= count;
+}
+
+static void push_value(int &value_depth, int &max_value_depth) {
+    ++value_depth;
+    max_value_depth = std::max(max_value_depth, value_depth);
+}
+
+void CsgProgram::sphere(glm::vec3 center, float radius) {
+    emit(Opcode::sphere, {center.x, center.y, center.z, radius});
+    push_value(value_depth, max_value_depth);
+}
+
+void CsgProgram::box(glm::vec3 center, glm::vec3 half_size) {
+    emit(Opcode::box, {center.x, center.y, center.z, half_size.x, half_size.y, half_size.z});
+    push_value(value_depth, max_value_depth);
+}
+
+void CsgProgram::torus(glm::vec3 center, float major_radius, float minor_radius) {
+    emit(Opcode::torus, {center.x, center.y, center.z, major_radius, minor_radius});
+    push_value(value_depth, max_value_depth);
+}
+
+void CsgProgram::translate(glm::vec3 offset) {
+    emit(Opcode::translate, {offset.x, offset.y, offset.z});
+    transform_stack.push_back(value_depth);
+    max_transform_depth = std::max(max_transform_depth, static_cast<int>(transform_stack.size()));
+}
+
+void CsgProgram::scale(float factor) {
+    // Distances are divided by the factor, which must keep them finite and their sign
+    if (!(factor > 0.0f)) {
+        std::cerr << "Error: CSG instruction [scale] expects a positive factor, got " << factor
+                  << std::endl;
+        abort();
+    }
+    emit(Opcode::scale, {factor});
+    transform_stack.push_back(value_depth);
+    max_transform_depth = std::max(max_transform_depth, static_cast<int>(transform_stack.size()));
+}
+
+void CsgProgram::pop_transform() {
+    // A transform applies to exactly one distance
+    if (transform_stack.empty() || value_depth != transform_stack.back() + 1) {
+        std::cerr << "Error: CSG instruction [pop] must close a transform wrapping exactly one "
+                     "distance"
+                  << std::endl;
+        abort();
+    }
+    emit(Opcode::pop_transform, {});
+    transform_stack.pop_back();
+}
+
+void CsgProgram::unite() {
+    pop_values(2, "union");
+    emit(Opcode::unite, {});
+    push_value(value_depth, max_value_depth);
+}
+
+void CsgProgram::intersect() {
+    pop_values(2, "intersection");
+    emit(Opcode::intersect, {});
+    push_value(value_depth, max_value_depth);
+}
+
+void CsgProgram::subtract() {
+    pop_values(2, "difference");
+    emit(Opcode::subtract, {});
+    push_value(value_depth, max_value_depth);
+}
+
+void CsgProgram::smooth_unite(float k) {
+    pop_values(2, "smooth_union");
+    emit(Opcode::smooth_unite, {k});
+    push_value(value_depth, max_value_depth);
+}
+
+bool CsgProgram::is_complete() const { return value_depth == 1 && transform_stack.empty(); }
+
+const std::vector<Instruction> &CsgProgram::code() const { return instructions; }
+
+const std::vector<float> &CsgProgram::parameters() const { return constants; }
+
+int CsgProgram::stack_size() const { return max_value_depth; }
+
+int CsgProgram::transform_stack_size() const { return max_transform_depth; }
+
+// ************************************ //
+//          Text form
+// ************************************ //
+
+CsgProgram CsgProgram::parse(std::istream &stream) {
+    CsgProgram program;
+    std::string line;
+    int line_number = 0;
+    while (std::getline(stream, line)) {
+        ++line_number;
+        std::istringstream words(line);
+        std::string name;
+        if (!(words >> name) || name[0] == '#') {
+            continue;
+        }
+
+        auto info = std::find_if(std::begin(opcode_infos), std::end(opcode_infos),
+                                 [&](const OpcodeInfo &info) { return name == info.name; });
+        if (info == std::end(opcode_infos)) {
+            std::cerr << "Error: unknown CSG instruction [" << name << "] at line " << line_number
+                      << std::endl;
+            abort();
+        }
+        float p[6];
+        for (int i = 0; i < info->nb_parameters; ++i) {
+            if (!(words >> p[i])) {
+                std::cerr << "Error: CSG instruction [" << name << "] at line " << line_number
+                          << " expects " << info->nb_parameters << " parameters" << std::endl;
+                abort();
+            }
+        }
+
+        switch (info->opcode) {
+        case Opcode::sphere:
+            program.sphere({p[0], p[1], p[2]}, p[3]);
+            break;
+        case Opcode::box:
+            program.box({p[0], p[1], p[2]}, {p[3], p[4], p[5]});
+            break;
+        case Opcode::torus:
+            program.torus({p[0], p[1], p[2]}, p[3], p[4]);
+            break;
+        case Opcode::translate:
+            program.translate({p[0], p[1], p[2]});
+            break;
+        case Opcode::scale:
+            if (!(p[0] > 0.0f)) {
+                std::cerr << "Error: CSG instruction [scale] at line " << line_number
+                          << " expects a positive factor" << std::endl;
+                abort();
+            }
+            program.scale(p[0]);
+            break;
+        case Opcode::pop_transform:
+            program.pop_transform();
+            break;
+        case Opcode::unite:
+            program.unite();
+            break;
+        case Opcode::intersect:
+            program.intersect();
+            break;
+        case Opcode::subtract:
+            program.subtract();
+            break;
+        case Opcode::smooth_unite:
+            program.smooth_unite(p[0]);
+            break;
+        }
+    }
+
+    if (!program.is_complete()) {
+        std::cerr << "Error: CSG program must end with exactly one distance and no open transform"
+                  << std::endl;
+        abort();
+    }
+    return program;
+}
+
+CsgProgram CsgProgram::load(const std::string &path) {
+    std::ifstream stream(path);
+    if (!stream.is_open()) {
+        std::cerr << "\n\nError: cannot open file [" << path << "]" << std::endl;
+        abort();
+    }
+    return parse(stream);
+}
+
+void CsgProgram::write(std::ostream &stream) const {
+    for (auto &instruction : instructions) {
+        auto &info = info_of(instruction.opcode);
+        stream << info.name;
+        for (int i = 0; i < info.nb_parameters; ++i) {
+            stream << ' ' << constants[instruction.operand + i];
+        }
+        stream << '\n';
+    }
+}
+
+// ************************************ //
+//          Interpreter
+// ************************************ //
+
+// Points interpreted together. Every opcode loops over the whole chunk.
+static const int chunk_size = 128;
+
+/** Runs a program over nb_lanes values of T (FloatBatch, Dual<FloatBatch> or Interval) */
+template <typename T> class Interpreter {
+private:
+    const CsgProgram &program;
+    int nb_lanes;
+    std::vector<T> values;
+    std::vector<T> frames;
+    std::vector<float> frame_scales;
+
+    T *value(int index) { return values.data() + index * nb_lanes; }
+
+    template <typename Primitive> void push_primitive(Primitive primitive, int &top, int level) {
+        T *x = frame(level, 0), *y = frame(level, 1), *z = frame(level, 2);
+        T *out = value(top++);
+        for (int lane = 0; lane < nb_lanes; ++lane) {
+            out[lane] = primitive(x[lane], y[lane], z[lane]);
+        }
+    }
+
+    template <typename Operation> void combine(Operation operation, int &top) {
+        T *right = value(--top);
+        T *left = value(top - 1);
+        for (int lane = 0; lane < nb_lanes; ++lane) {
+            left[lane] = operation(left[lane], right[lane]);
+        }
+    }
+
+    template <typename Transform>
+    void push_frame(Transform transform, int &level, float scale_factor) {
+        for (int axis = 0; axis < 3; ++axis) {
+            T *from = frame(level, axis);
+            T *to = frame(level + 1, axis);
+            for (int lane = 0; lane < nb_lanes; ++lane) {
+                to[lane] = transform(from[lane], axis);
+            }
+        }
+        frame_scales[++level] = scale_factor;
+    }
+
+public:
+    Interpreter(const CsgProgram &program, int nb_lanes)
+        : program(program), nb_lanes(nb_lanes), values(program.stack_size() * nb_lanes),
+          frames(3 * (program.transform_stack_size() + 1) * nb_lanes),
+          frame_scales(program.transform_stack_size() + 1, 1.0f) {}
+
+    /** Positions along axis in the frame opened by the level-th transform. The caller fills
+     * level 0 before run(). */
+    T *frame(int level, int axis) { return frames.data() + (3 * level + axis) * nb_lanes; }
+
+    /** Run the program and return the final distances */
+    const T *run() {
+        using std::max;
+        using std::min;
+        auto &constants = program.parameters();
+        int top = 0;
+        int level = 0;
+        for (auto &instruction : program.code()) {
+            const float *p = constants.data() + instruction.operand;
+            switch (instruction.opcode) {
+            case Opcode::sphere:
+                push_primitive(csg::sphere({p[0], p[1], p[2]}, p[3]), top, level);
+                break;
+            case Opcode::box:
+                push_primitive(csg::box({p[0], p[1], p[2]}, {p[3], p[4], p[5]}), top, level);
+                break;
+            case Opcode::torus:
+                push_primitive(csg::torus({p[0], p[1], p[2]}, p[3], p[4]), top, level);
+                break;
+            case Opcode::translate:
+                push_frame([&](T position, int axis) { return position - p[axis]; }, level, 1.0f);
+                break;
+            case Opcode::scale:
+                push_frame([&](T position, int) { return position / p[0]; }, level, p[0]);
+                break;
+            case Opcode::pop_transform:
+                if (frame_scales[level] != 1.0f) {
+                    T *distances = value(top - 1);
+                    for (int lane = 0; lane < nb_lanes; ++lane) {
+                        distances[lane] = distances[lane] * frame_scales[level];
+                    }
+                }
+                --level;
+                break;
+            case Opcode::unite:
+                combine([](T a, T b) { return min(a, b); }, top);
+                break;
+            case Opcode::intersect:
+                combine([](T a, T b) { return max(a, b); }, top);
+                break;
+            case Opcode::subtract:
+                combine([](T a, T b) { return max(a, -b); }, top);
+                break;
+            case Opcode::smooth_unite:
+                combine([&](T a, T b) { return csg::smooth_min(a, b, p[0]); }, top);
+                break;
+            }
+        }
+        return value(0);
+    }
+};
+
+ProgramField::ProgramField(CsgProgram program) : program(std::move(program)) {
+    if (!this->program.is_complete()) {
+        std::cerr << "Error: CSG program must end with exactly one distance and no open transform"
+                  << std::endl;
+        abort();
+    }
+}
+
+/** Interpret the program over count positions, chunk by chunk. load(values, axis) turns
+ * FloatBatch::width floats into a T, and store(result, index) writes the results of a batch. */
+template <typename T, typename Load, typename Store>
+static void interpret(const CsgProgram &program, PositionSpan positions, Load load,
+                      Store store) {
+    constexpr int width = FloatBatch::width;
+    constexpr int nb_lanes = chunk_size / width;
+    Interpreter<T> interpreter(program, nb_lanes);
+    float padded[3][chunk_size];
+
+    for (size_t start = 0; start < positions.count; start += chunk_size) {
+        size_t count = std::min<size_t>(chunk_size, positions.count - start);
+        const float *axes[3] = {positions.x + start, positions.y + start, positions.z + start};
+        if (count < chunk_size) {
+            // Pad the last chunk by repeating its last point
+            for (int axis = 0; axis < 3; ++axis) {
+                std::copy_n(axes[axis], count, padded[axis]);
+                std::fill(padded[axis] + count, padded[axis] + chunk_size, axes[axis][count - 1]);
+                axes[axis] = padded[axis];
+            }
+        }
+        for (int axis = 0; axis < 3; ++axis) {
+            T *frame = interpreter.frame(0, axis);
+            for (int lane = 0; lane < nb_lanes; ++lane) {
+                frame[lane] = load(axes[axis] + lane * width, axis);
+            }
+        }
+        const T *result = interpreter.run();
+        for (int lane = 0; lane < nb_lanes; ++lane) {
+            store(result[lane], start + lane * width,
+                  count - std::min<size_t>(count, lane * width));
+        }
+    }
+}
+
+void ProgramField::evaluate(PositionSpan positions, float *distances) const {
+    constexpr size_t width = FloatBatch::width;
+    interpret<FloatBatch>(
+        program, positions, [](const float *p, int) { return FloatBatch::load(p); },
+        [&](FloatBatch result, size_t index, size_t remaining) {
+            if (remaining >= width) {
+                result.store(distances + index);
+            } else if (remaining > 0) {
+                float tail[width];
+                result.store(tail);
+                std::copy_n(tail, remaining, distances + index);
+            }
+        });
+}
+
+void ProgramField::evaluate_gradient(PositionSpan positions, float *distances, float *gradient_x,
+                                     float *gradient_y, float *gradient_z) const {
+    using D = Dual<FloatBatch>;
+    constexpr size_t width = FloatBatch::width;
+    interpret<D>(
+        program, positions,
+        [](const float *p, int axis) { return D::variable(FloatBatch::load(p), axis); },
+        [&](D result, size_t index, size_t remaining) {
+            float *outputs[4] = {distances, gradient_x, gradient_y, gradient_z};
+            FloatBatch parts[4] = {result.value, result.dx, result.dy, result.dz};
+            for (int i = 0; i < 4; ++i) {
+                if (remaining >= width) {
+                    parts[i].store(outputs[i] + index);
+                } else if (remaining > 0) {
+                    float tail[width];
+                    parts[i].store(tail);
+                    std::copy_n(tail, remaining, outputs[i] + index);
+                }
+            }
+        });
+}
+
+Interval ProgramField::evaluate_interval(glm::vec3 box_min, glm::vec3 box_max) const {
+    Interpreter<Interval> interpreter(program, 1);
+    for (int axis = 0; axis < 3; ++axis) {
+        interpreter.frame(0, axis)[0] = {box_min[axis], box_max[axis]};
+    }
+    return interpreter.run()[0];
+}
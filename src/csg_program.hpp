@@ -0,0 +1,90 @@
+#pragma once
+
+#include <cstdint>
+#include <initializer_list>
+#include <iosfwd>
+#include <string>
+#include <vector>
+
+#include <glm/glm.hpp>
+
+#include "sdf_field.hpp"
+
+// Runtime CSG scenes, for scenes that come from files or user edits and cannot be
+// compile-time csg.hpp expressions. A scene is a small stack bytecode: primitives push a
+// distance, booleans pop two distances and push one, and transforms change the position
+// frame seen by the instructions up to the matching pop_transform.
+
+enum class Opcode : uint8_t {
+    sphere,        // center, radius
+    box,           // center, half size
+    torus,         // center, major radius, minor radius
+    translate,     // offset
+    scale,         // uniform factor, positive
+    pop_transform, //
+    unite,         //
+    intersect,     //
+    subtract,      // first minus second
+    smooth_unite,  // blend radius
+};
+
+struct Instruction {
+    Opcode opcode;
+    uint32_t operand; // Index of the first parameter in the constants
+};
+
+class CsgProgram {
+private:
+    std::vector<Instruction> instructions;
+    std::vector<float> constants;
+    // Values on the stack when each open transform was pushed
+    std::vector<int> transform_stack;
+    int value_depth;
+    int max_value_depth;
+    int max_transform_depth;
+
+    void emit(Opcode opcode, std::initializer_list<float> parameters);
+    void pop_values(int count, const char *opcode_name);
+
+public:
+    CsgProgram();
+
+    void sphere(glm::vec3 center, float radius);
+    void box(glm::vec3 center, glm::vec3 half_size);
+    void torus(glm::vec3 center, float major_radius, float minor_radius);
+    void translate(glm::vec3 offset);
+    void scale(float factor);
+    void pop_transform();
+    void unite();
+    void intersect();
+    void subtract();
+    void smooth_unite(float k);
+
+    /** A complete program leaves exactly one distance and no open transform */
+    bool is_complete() const;
+
+    const std::vector<Instruction> &code() const;
+    const std::vector<float> &parameters() const;
+    int stack_size() const;
+    int transform_stack_size() const;
+
+    /** Text form: one instruction per line, opcode name followed by its parameters,
+     * e.g. "sphere 0 0 -2 0.2". Lines starting with # are comments. */
+    static CsgProgram parse(std::istream &stream);
+    static CsgProgram load(const std::string &path);
+    void write(std::ostream &stream) const;
+};
+
+/** SdfField interpreting a CsgProgram. Each opcode runs over a whole chunk of points before
+ * the next one is decoded, so dispatch is paid once per chunk instead of once per point. */
+class ProgramField : public SdfField {
+private:
+    CsgProgram program;
+
+public:
+    ProgramField(CsgProgram program);
+    void evaluate(PositionSpan positions, float *distances) const override;
+    void evaluate_gradient(PositionSpan positions, float *distances, float *gradient_x,
+                           float *gradient_y, float *gradient_z) const override;
+    Interval evaluate_interval(glm::vec3 box_min, glm::vec3 box_max) const override;
+};
@@ -0,0 +1,234 @@
+#include <algorithm>
+#include <cmath>
+#include <cstring>
+
+#include "distance_encoding.hpp"
+
+static const char *mode_names[] = {"fixed", "voxel_band", "block_range", "companded"};
+
+const char *encoding_mode_name(EncodingMode mode) { return mode_names[static_cast<int>(mode)]; }
+
+bool parse_encoding_mode(const std::string &name, EncodingMode &mode) {
+    for (int i = 0; i < 4; ++i) {
+        if (name == mode_names[i]) {
+            mode = static_cast<EncodingMode>(i);
+            return true;
+        }
+    }
+    return false;
+}
+
+static const char *format_names[] = {"r8", "r16", "r16f", "r32f"};
+
+const char *distance_format_name(DistanceFormat format) {
+    return format_names[static_cast<int>(format)];
+}
+
+bool parse_distance_format(const std::string &name, DistanceFormat &format) {
+    for (int i = 0; i < 4; ++i) {
+        if (name == format_names[i]) {
+            format = static_cast<DistanceFormat>(i);
+            return true;
+        }
+    }
+    return false;
+}
+
+size_t distance_texel_bytes(DistanceFormat format) {
+    switch (format) {
+    case DistanceFormat::r16:
+    case DistanceFormat::r16f:
+        return 2;
+    case DistanceFormat::r32f:
+        return 4;
+    case DistanceFormat::r8:
+        break;
+    }
+    return 1;
+}
+
+GLenum distance_internal_format(DistanceFormat format) {
+    switch (format) {
+    case DistanceFormat::r16:
+        return GL_R16;
+    case DistanceFormat::r16f:
+        return GL_R16F;
+    case DistanceFormat::r32f:
+        return GL_R32F;
+    case DistanceFormat::r8:
+        break;
+    }
+    return GL_R8;
+}
+
+GLenum distance_pixel_type(DistanceFormat format) {
+    switch (format) {
+    case DistanceFormat::r16:
+        return GL_UNSIGNED_SHORT;
+    case DistanceFormat::r16f:
+        return GL_HALF_FLOAT;
+    case DistanceFormat::r32f:
+        return GL_FLOAT;
+    case DistanceFormat::r8:
+        break;
+    }
+    return GL_UNSIGNED_BYTE;
+}
+
+uint16_t float_to_half(float value) {
+    uint32_t bits;
+    std::memcpy(&bits, &value, sizeof(bits));
+    uint32_t sign = (bits >> 16) & 0x8000u;
+    bits &= 0x7fffffffu;
+    uint16_t half;
+    if (bits >= (143u << 23)) {
+        // Beyond the largest half, or infinite or NaN
+        half = bits > (255u << 23) ? 0x7e00 : 0x7c00;
+    } else if (bits < (113u << 23)) {
+        // Subnormal half: the float addition aligns and rounds the 10 mantissa bits
+        const uint32_t magic_bits = 126u << 23;
+        float magic, sum;
+        std::memcpy(&magic, &magic_bits, sizeof(magic));
+        std::memcpy(&sum, &bits, sizeof(sum));
+        sum += magic;
+        std::memcpy(&bits, &sum, sizeof(bits));
+        half = static_cast<uint16_t>(bits - magic_bits);
+    } else {
+        // Rebias the exponent and round the 13 dropped bits to nearest even
+        uint32_t odd = (bits >> 13) & 1u;
+        bits += (static_cast<uint32_t>(15 - 127) << 23) + 0xfffu + odd;
+        half = static_cast<uint16_t>(bits >> 13);
+    }
+    return static_cast<uint16_t>(half | sign);
+}
+
+float half_to_float(uint16_t half) {
+    uint32_t sign = static_cast<uint32_t>(half & 0x8000u) << 16;
+    uint32_t exponent = (half >> 10) & 0x1fu;
+    uint32_t mantissa = half & 0x3ffu;
+    if (exponent == 0) {
+        float magnitude = std::ldexp(static_cast<float>(mantissa), -24);
+        return sign ? -magnitude : magnitude;
+    }
+    uint32_t bits = sign | (exponent == 31 ? 0x7f800000u | (mantissa << 13)
+                                           : ((exponent + 112) << 23) | (mantissa << 13));
+    float value;
+    std::memcpy(&value, &bits, sizeof(value));
+    return value;
+}
+
+DistanceEncoding DistanceEncoding::fixed() { return linear_range(-max_distance, max_distance); }
+
+DistanceEncoding DistanceEncoding::voxel_band(float band_texels, float texel_size) {
+    float band = std::min(band_texels * texel_size, max_distance);
+    return linear_range(-band, band);
+}
+
+DistanceEncoding DistanceEncoding::linear_range(float lower, float upper) {
+    lower = std::max(lower, -max_distance);
+    upper = std::min(upper, max_distance);
+    if (!std::isfinite(lower) || !std::isfinite(upper) || !(lower < upper)) {
+        lower = -max_distance;
+        upper = max_distance;
+    }
+    // The upper end maps to 256 and saturates at 255, as in the historical encoding
+    float scale = 256.0f / (upper - lower);
+    return {DistanceCurve::linear, scale, -lower * scale, 0.0f, 0.0f};
+}
+
+DistanceEncoding DistanceEncoding::companded(float range, float mu) {
+    return {DistanceCurve::mu_law, 128.0f, 128.0f, std::min(range, max_distance), mu};
+}
+
+float DistanceEncoding::code_position(float distance) const {
+    float position;
+    if (curve == DistanceCurve::mu_law) {
+        distance = std::clamp(distance, -range, range);
+        float u = std::log1p(mu * std::abs(distance) / range) / std::log1p(mu);
+        position = std::copysign(u, distance) * scale + bias;
+    } else {
+        // Offset first, so that the fixed encoding gives the historical bytes
+        position = (distance + bias / scale) * scale;
+    }
+    return std::clamp(position, 0.0f, 256.0f);
+}
+
+float DistanceEncoding::decode_position(float position) const {
+    float u = (position - bias) / scale;
+    if (curve == DistanceCurve::mu_law) {
+        return std::copysign(range * std::expm1(std::abs(u) * std::log1p(mu)) / mu, u);
+    }
+    return u;
+}
+
+// The upper end of the code axis saturates to the last code
+GLubyte DistanceEncoding::encode(float distance) const {
+    return static_cast<GLubyte>(std::min(code_position(distance), 255.0f));
+}
+
+uint16_t DistanceEncoding::encode16(float distance) const {
+    return static_cast<uint16_t>(std::min(code_position(distance) * 256.0f, 65535.0f));
+}
+
+float DistanceEncoding::saturation_distance() const {
+    return std::max(std::abs(decode_position(0.0f)), std::abs(decode_position(256.0f)));
+}
+
+float DistanceEncoding::decode(GLubyte code) const {
+    return decode_position(static_cast<float>(code) + 0.5f);
+}
+
+float DistanceEncoding::decode16(uint16_t code) const {
+    return decode_position((static_cast<float>(code) + 0.5f) / 256.0f);
+}
+
+float DistanceEncoding::round_trip(float distance, DistanceFormat format) const {
+    switch (format) {
+    case DistanceFormat::r16:
+        return decode16(encode16(distance));
+    case DistanceFormat::r16f:
+        return half_to_float(float_to_half(glm::clamp(distance, -max_distance, max_distance)));
+    case DistanceFormat::r32f:
+        return glm::clamp(distance, -max_distance, max_distance);
+    case DistanceFormat::r8:
+        break;
+    }
+    return decode(encode(distance));
+}
+
+void DistanceEncoding::set_uniforms(GLuint program) const {
+    glUniform1i(glGetUniformLocation(program, "distance_curve"), static_cast<GLint>(curve));
+    glUniform1f(glGetUniformLocation(program, "distance_scale"), scale);
+    glUniform1f(glGetUniformLocation(program, "distance_bias"), bias);
+    glUniform1f(glGetUniformLocation(program, "distance_range"), range);
+    glUniform1f(glGetUniformLocation(program, "distance_mu"), mu);
+}
+
+bool DistanceEncoding::operator==(const DistanceEncoding &other) const {
+    return curve == other.curve && scale == other.scale && bias == other.bias &&
+           range == other.range && mu == other.mu;
+}
+
+bool DistanceEncoding::operator!=(const DistanceEncoding &other) const {
+    return !(*this == other);
+}
+
+DistanceEncoding choose_encoding(EncodingMode mode, const SdfField &field, glm::vec3 origin,
+                                 float block_size, int nb_texels) {
+    float texel_size = block_size / nb_texels;
+    switch (mode) {
+    case EncodingMode::voxel_band:
+        return DistanceEncoding::voxel_band(DistanceEncoding::voxel_band_texels, texel_size);
+    case EncodingMode::block_range: {
+        auto first_center = origin + glm::vec3(texel_size / 2);
+        auto last_center = origin + glm::vec3(block_size - texel_size / 2);
+        auto bounds = field.evaluate_interval(first_center, last_center);
+        return DistanceEncoding::linear_range(bounds.lower, bounds.upper);
+    }
+    case EncodingMode::companded:
+        return DistanceEncoding::companded();
+    case EncodingMode::fixed:
+        break;
+    }
+    return DistanceEncoding::fixed();
+}
@@ -0,0 +1,111 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <glad/glad.hpp>
+#include <glm/glm.hpp>
+#include <string>
+
+#include "sdf_field.hpp"
+
+// Quantization of the baked distances. A distance maps to a position c in [0, 256] on the
+// code axis and back through u = (c - bias) / scale: the linear curve returns u itself, the
+// mu-law curve expands it to sign(u) * range * ((1 + mu)^|u| - 1) / mu, which spends most codes
+// near the surface where sphere tracing needs them. 8-bit codes keep the integer part of c,
+// 16-bit codes 256 steps per 8-bit code, and both decode to the center of their step. Every
+// encoding is monotonic, which lets the bake fill octants whose bounds saturate it, and none of
+// them saturates beyond max_distance, so a change of the field never moves the codes further
+// away than that.
+
+enum class DistanceCurve : int32_t { linear = 0, mu_law = 1 };
+
+/** How a block picks its encoding. fixed is [-4, 4] at 32 codes per unit, the historical
+ * bytes. voxel_band spends the 256 codes on a band of a few texels around the surface.
+ * block_range spreads them over the bounds of the field in the block. companded applies a
+ * mu-law curve over [-4, 4]. */
+enum class EncodingMode { fixed, voxel_band, block_range, companded };
+
+/** Name of a mode as the tools print and parse it */
+const char *encoding_mode_name(EncodingMode mode);
+
+/** Parse a mode name, returning false if there is no such mode */
+bool parse_encoding_mode(const std::string &name, EncodingMode &mode);
+
+/** Storage of the distance texture. r8 and r16 hold codes of the block encoding, r16f and r32f
+ * the distance itself clamped to +-max_distance, which the encoding does not apply to. */
+enum class DistanceFormat { r8, r16, r16f, r32f };
+
+const char *distance_format_name(DistanceFormat format);
+bool parse_distance_format(const std::string &name, DistanceFormat &format);
+
+/** Bytes of one texel of the distance texture */
+size_t distance_texel_bytes(DistanceFormat format);
+
+/** Internal format and pixel type of the distance texture, its channel being GL_RED */
+GLenum distance_internal_format(DistanceFormat format);
+GLenum distance_pixel_type(DistanceFormat format);
+
+/** IEEE half-float bits of a float, rounded to nearest even, and back */
+uint16_t float_to_half(float value);
+float half_to_float(uint16_t half);
+
+/** Parameters of an encoding, stored next to the bytes they encode. Plain data without
+ * padding, so that it can be hashed and written as is. */
+struct DistanceEncoding {
+    DistanceCurve curve;
+    float scale;
+    float bias;
+    float range;
+    float mu;
+
+    static constexpr float max_distance = 4.0f;
+
+    /** Texels on each side of the surface covered by the voxel_band mode */
+    static constexpr float voxel_band_texels = 4.0f;
+
+    /** [-4, 4] mapped linearly to [0, 255] */
+    static DistanceEncoding fixed();
+
+    /** Linear over +-band_texels texels of size texel_size, at most +-max_distance */
+    static DistanceEncoding voxel_band(float band_texels, float texel_size);
+
+    /** Linear over [lower, upper] clipped to +-max_distance, or fixed if unbounded */
+    static DistanceEncoding linear_range(float lower, float upper);
+
+    /** mu-law over +-range, at most +-max_distance */
+    static DistanceEncoding companded(float range = max_distance, float mu = 255.0f);
+
+    /** Position of a distance on the code axis, clamped to [0, 256] */
+    float code_position(float distance) const;
+
+    /** Distance at a position of the code axis */
+    float decode_position(float position) const;
+
+    /** Distance beyond which the codes saturate on both sides */
+    float saturation_distance() const;
+
+    GLubyte encode(float distance) const;
+    uint16_t encode16(float distance) const;
+
+    /** Distance at the center of the quantization step of a code */
+    float decode(GLubyte code) const;
+    float decode16(uint16_t code) const;
+
+    /** Distance read back from a texel of format holding distance. The float formats ignore
+     * the encoding and only clamp to +-max_distance and round. */
+    float round_trip(float distance, DistanceFormat format) const;
+
+    /** Set the decode parameters of a program declaring the uniforms distance_curve,
+     * distance_scale, distance_bias, distance_range and distance_mu. The program must be
+     * in use. */
+    void set_uniforms(GLuint program) const;
+
+    bool operator==(const DistanceEncoding &other) const;
+    bool operator!=(const DistanceEncoding &other) const;
+};
+
+/** Encoding of mode for the block of side block_size at origin baked at nb_texels.
+ * voxel_band covers voxel_band_texels texels on each side of the surface, block_range bounds
+ * the field with SdfField::evaluate_interval over the texel centers. */
+DistanceEncoding choose_encoding(EncodingMode mode, const SdfField &field, glm::vec3 origin,
+                                 float block_size, int nb_texels);
@@ -0,0 +1,132 @@
+#include <algorithm>
+#include <cmath>
+
+#include "distance_grid.hpp"
+#include "thread_pool.hpp"
+
+static const char *layout_names[] = {"linear", "bricked"};
+
+const char *grid_layout_name(GridLayout layout) { return layout_names[static_cast<int>(layout)]; }
+
+DistanceGrid::DistanceGrid()
+    : size{0}, origin{0.0f}, voxel_size{0.0f}, layout{GridLayout::linear}, strides{0, 0, 0} {}
+
+DistanceGrid::DistanceGrid(glm::ivec3 size, glm::vec3 origin, float voxel_size,
+                           GridLayout layout)
+    : size{size}, origin{origin}, voxel_size{voxel_size}, layout{layout} {
+    // Whole bricks, whose samples take the low bits of the index
+    auto extent = layout == GridLayout::bricked ? (size + brick_size - 1) / brick_size : size;
+    size_t step = layout == GridLayout::bricked ? brick_size * brick_size * brick_size : 1;
+    strides[0] = step;
+    strides[1] = strides[0] * extent.x;
+    strides[2] = strides[1] * extent.y;
+    values.resize(strides[2] * extent.z);
+}
+
+DistanceGrid DistanceGrid::for_block(glm::vec3 block_origin, float block_size, int nb_texels,
+                                     GridLayout layout) {
+    auto texel_size = block_size / nb_texels;
+    return DistanceGrid(glm::ivec3(nb_texels), block_origin + glm::vec3(texel_size / 2),
+                        texel_size, layout);
+}
+
+void DistanceGrid::sample_field(const SdfField &field) {
+    ThreadPool::global().parallel_for(size.z, [&](int z) {
+        std::vector<float> position_x(size.x), position_y(size.x), position_z(size.x);
+        // The bricked layout is filled through a row of samples
+        std::vector<float> row(layout == GridLayout::bricked ? size.x : 0);
+        for (int y = 0; y < size.y; ++y) {
+            for (int x = 0; x < size.x; ++x) {
+                auto sample_position = position(x, y, z);
+                position_x[x] = sample_position.x;
+                position_y[x] = sample_position.y;
+                position_z[x] = sample_position.z;
+            }
+            PositionSpan positions{position_x.data(), position_y.data(), position_z.data(),
+                                   static_cast<size_t>(size.x)};
+            if (layout == GridLayout::linear) {
+                field.evaluate(positions, &values[index(0, y, z)]);
+            } else {
+                field.evaluate(positions, row.data());
+                for (int x = 0; x < size.x; ++x) {
+                    at(x, y, z) = row[x];
+                }
+            }
+        }
+    });
+}
+
+DistanceGrid DistanceGrid::with_layout(GridLayout new_layout) const {
+    DistanceGrid grid(size, origin, voxel_size, new_layout);
+    ThreadPool::global().parallel_for(size.z, [&](int z) {
+        for (int y = 0; y < size.y; ++y) {
+            for (int x = 0; x < size.x; ++x) {
+                grid.at(x, y, z) = at(x, y, z);
+            }
+        }
+    });
+    return grid;
+}
+
+std::vector<float> DistanceGrid::linear_values() const {
+    if (layout == GridLayout::linear) {
+        return values;
+    }
+    return with_layout(GridLayout::linear).values;
+}
+
+glm::vec3 DistanceGrid::position(int x, int y, int z) const {
+    return origin + glm::vec3(x, y, z) * voxel_size;
+}
+
+GridField::GridField(std::shared_ptr<const DistanceGrid> grid) : grid(std::move(grid)) {}
+
+// Trilinear interpolation, and its gradient when gradient is not null
+static float sample(const DistanceGrid &grid, glm::vec3 position, glm::vec3 *gradient) {
+    auto coordinates = glm::clamp((position - grid.origin) / grid.voxel_size, glm::vec3(0.0f),
+                                  glm::vec3(grid.size - 1));
+    auto lower = glm::min(glm::ivec3(coordinates), glm::max(grid.size - 2, glm::ivec3(0)));
+    auto upper = glm::min(lower + 1, grid.size - 1);
+    auto t = coordinates - glm::vec3(lower);
+
+    // Corner indices as sums of per-axis offsets, six offsets for the eight corners
+    size_t x0 = grid.offset(0, lower.x), x1 = grid.offset(0, upper.x);
+    size_t y0 = grid.offset(1, lower.y), y1 = grid.offset(1, upper.y);
+    size_t z0 = grid.offset(2, lower.z), z1 = grid.offset(2, upper.z);
+    const float *values = grid.values.data();
+    float c000 = values[x0 + y0 + z0], c100 = values[x1 + y0 + z0];
+    float c010 = values[x0 + y1 + z0], c110 = values[x1 + y1 + z0];
+    float c001 = values[x0 + y0 + z1], c101 = values[x1 + y0 + z1];
+    float c011 = values[x0 + y1 + z1], c111 = values[x1 + y1 + z1];
+
+    float c00 = c000 + (c100 - c000) * t.x, c10 = c010 + (c110 - c010) * t.x;
+    float c01 = c001 + (c101 - c001) * t.x, c11 = c011 + (c111 - c011) * t.x;
+    float c0 = c00 + (c10 - c00) * t.y, c1 = c01 + (c11 - c01) * t.y;
+
+    if (gradient) {
+        float dx0 = (c100 - c000) + ((c110 - c010) - (c100 - c000)) * t.y;
+        float dx1 = (c101 - c001) + ((c111 - c011) - (c101 - c001)) * t.y;
+        float dy = (c10 - c00) + ((c11 - c01) - (c10 - c00)) * t.z;
+        *gradient = glm::vec3(dx0 + (dx1 - dx0) * t.z, dy, c1 - c0) / grid.voxel_size;
+    }
+    return c0 + (c1 - c0) * t.z;
+}
+
+void GridField::evaluate(PositionSpan positions, float *distances) const {
+    for (size_t i = 0; i < positions.count; ++i) {
+        distances[i] =
+            sample(*grid, glm::vec3(positions.x[i], positions.y[i], positions.z[i]), nullptr);
+    }
+}
+
+void GridField::evaluate_gradient(PositionSpan positions, float *distances, float *gradient_x,
+                                  float *gradient_y, float *gradient_z) const {
+    for (size_t i = 0; i < positions.count; ++i) {
+        glm::vec3 gradient;
+        distances[i] =
+            sample(*grid, glm::vec3(positions.x[i], positions.y[i], positions.z[i]), &gradient);
+        gradient_x[i] = gradient.x;
+        gradient_y[i] = gradient.y;
+        gradient_z[i] = gradient.z;
+    }
+}
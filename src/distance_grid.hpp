@@ -0,0 +1,79 @@
+#pragma once
+
+#include <cstddef>
+#include <memory>
+#include <vector>
+
+#include <glm/glm.hpp>
+
+#include "morton.hpp"
+#include "sdf_field.hpp"
+
+/** Order of the samples of a DistanceGrid in memory. linear stores them x-fastest, as
+ * textures are uploaded. bricked stores bricks of 8^3 samples one after the other, x-fastest,
+ * and the samples of a brick in Morton order (see morton.hpp), so that the neighbours of a
+ * sample along any axis mostly share its cache lines. The grid is padded to whole bricks. */
+enum class GridLayout { linear, bricked };
+
+const char *grid_layout_name(GridLayout layout);
+
+/** Regular grid of float distances. Sample (x, y, z) sits at origin + (x, y, z) * voxel_size
+ * and is stored at index(x, y, z). In both layouts the index is the sum of one offset per
+ * coordinate, so the neighbour of a sample along an axis is found by swapping one offset. */
+struct DistanceGrid {
+    static constexpr int brick_shift = 3;
+    static constexpr int brick_size = 1 << brick_shift;
+
+    glm::ivec3 size;
+    glm::vec3 origin;
+    float voxel_size;
+    GridLayout layout;
+    /** Distance in values between consecutive samples along each axis, or between consecutive
+     * bricks for the bricked layout */
+    size_t strides[3];
+    std::vector<float> values;
+
+    DistanceGrid();
+    DistanceGrid(glm::ivec3 size, glm::vec3 origin, float voxel_size,
+                 GridLayout layout = GridLayout::linear);
+
+    /** Grid whose samples are the texel centers of a Block with the same parameters */
+    static DistanceGrid for_block(glm::vec3 block_origin, float block_size, int nb_texels,
+                                  GridLayout layout = GridLayout::linear);
+
+    /** Fill the grid with the field at every sample, one z slice per task */
+    void sample_field(const SdfField &field);
+
+    /** Same samples stored in another layout */
+    DistanceGrid with_layout(GridLayout new_layout) const;
+
+    /** Samples x-fastest, the order glTexImage3D expects, whatever the layout */
+    std::vector<float> linear_values() const;
+
+    /** Part of the index of the samples whose coordinate along axis is coordinate */
+    size_t offset(int axis, int coordinate) const {
+        if (layout == GridLayout::linear) {
+            return coordinate * strides[axis];
+        }
+        return (coordinate >> brick_shift) * strides[axis] +
+               (morton_spread(coordinate & (brick_size - 1)) << axis);
+    }
+
+    size_t index(int x, int y, int z) const { return offset(0, x) + offset(1, y) + offset(2, z); }
+    float &at(int x, int y, int z) { return values[index(x, y, z)]; }
+    float at(int x, int y, int z) const { return values[index(x, y, z)]; }
+    glm::vec3 position(int x, int y, int z) const;
+};
+
+/** Trilinear interpolation of a DistanceGrid, clamped at its borders. Sampling a grid made
+ * with DistanceGrid::for_block at the texel centers returns the stored values exactly. */
+class GridField : public SdfField {
+private:
+    std::shared_ptr<const DistanceGrid> grid;
+
+public:
+    GridField(std::shared_ptr<const DistanceGrid> grid);
+    void evaluate(PositionSpan positions, float *distances) const override;
+    void evaluate_gradient(PositionSpan positions, float *distances, float *gradient_x,
+                           float *gradient_y, float *gradient_z) const override;
+};
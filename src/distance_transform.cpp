@@ -0,0 +1,196 @@
+#include <algorithm>
+#include <cmath>
+#include <fstream>
+#include <iostream>
+
+#include "distance_transform.hpp"
+#include "thread_pool.hpp"
+
+// Squared distance standing for "no feature voxel on this line"
+static const float far_away = 1e20f;
+
+OccupancyGrid load_occupancy(const std::string &path, glm::ivec3 size, glm::vec3 origin,
+                             float voxel_size) {
+    OccupancyGrid occupancy{size, origin, voxel_size, {}};
+    occupancy.inside.resize(static_cast<size_t>(size.x) * size.y * size.z);
+
+    std::ifstream stream(path, std::ios::binary);
+    if (!stream.is_open()) {
+        std::cerr << "\n\nError: cannot open file [" << path << "]" << std::endl;
+        abort();
+    }
+    stream.read(reinterpret_cast<char *>(occupancy.inside.data()), occupancy.inside.size());
+    if (static_cast<size_t>(stream.gcount()) != occupancy.inside.size()) {
+        std::cerr << "Error: occupancy file [" << path << "] is smaller than " << size.x << "x"
+                  << size.y << "x" << size.z << std::endl;
+        abort();
+    }
+    return occupancy;
+}
+
+/** Scratch buffers of the 1D transform, one set per line being processed */
+struct LineBuffers {
+    std::vector<float> input;
+    std::vector<float> output;
+    std::vector<int> parabolas;
+    std::vector<double> boundaries;
+
+    LineBuffers(int n) : input(n), output(n), parabolas(n), boundaries(n + 1) {}
+};
+
+// 1D squared distance transform: output[q] = min over p of (q - p)^2 + input[p], as the lower
+// envelope of the parabolas rooted at every sample
+static void transform_line(int n, LineBuffers &buffers) {
+    const float *f = buffers.input.data();
+    int *v = buffers.parabolas.data();
+    double *z = buffers.boundaries.data();
+
+    // Samples with no feature voxel on their line cannot lower the envelope, only the others
+    // root a parabola
+    int first = 0;
+    while (first < n && f[first] >= far_away) {
+        ++first;
+    }
+    if (first == n) {
+        std::fill(buffers.output.begin(), buffers.output.end(), far_away);
+        return;
+    }
+
+    int k = 0;
+    v[0] = first;
+    z[0] = -HUGE_VAL;
+    z[1] = HUGE_VAL;
+    for (int q = first + 1; q < n; ++q) {
+        if (f[q] >= far_away) {
+            continue;
+        }
+        double s;
+        while (true) {
+            int p = v[k];
+            s = ((f[q] + double(q) * q) - (f[p] + double(p) * p)) / (2.0 * (q - p));
+            if (s > z[k] || k == 0) {
+                break;
+            }
+            --k;
+        }
+        if (s <= z[k]) {
+            // Only possible for k == 0: the new parabola hides the first one entirely
+            v[0] = q;
+            z[1] = HUGE_VAL;
+            continue;
+        }
+        ++k;
+        v[k] = q;
+        z[k] = s;
+        z[k + 1] = HUGE_VAL;
+    }
+
+    k = 0;
+    for (int q = 0; q < n; ++q) {
+        while (z[k + 1] < q) {
+            ++k;
+        }
+        float offset = static_cast<float>(q - v[k]);
+        buffers.output[q] = std::min(offset * offset + f[v[k]], far_away);
+    }
+}
+
+// Lines along y and z moved between the grid and the line buffers together, so that each cache
+// line of the grid is read and written once instead of once per line
+static const int lines_per_batch = 16;
+
+// Run the 1D transform along axis over every line of the grid, in place
+static void transform_axis(std::vector<float> &values, glm::ivec3 size, int axis) {
+    // The two other axes index the lines, the slowest one is split between the threads
+    int other_1 = axis == 0 ? 1 : 0;
+    int other_2 = axis == 2 ? 1 : 2;
+    glm::ivec3 strides(1, size.x, size.x * size.y);
+    int n = size[axis];
+    // Lines along x are contiguous already, the others are batched along x
+    int batch = axis == 0 ? 1 : lines_per_batch;
+
+    ThreadPool::global().parallel_for(size[other_2], [&](int j) {
+        LineBuffers buffers(n);
+        std::vector<float> block(static_cast<size_t>(batch) * n);
+        for (int i = 0; i < size[other_1]; i += batch) {
+            int nb_lines = std::min(batch, size[other_1] - i);
+            size_t first = static_cast<size_t>(i) * strides[other_1] +
+                           static_cast<size_t>(j) * strides[other_2];
+            for (int q = 0; q < n; ++q) {
+                const float *row = &values[first + static_cast<size_t>(q) * strides[axis]];
+                for (int line = 0; line < nb_lines; ++line) {
+                    block[static_cast<size_t>(line) * n + q] = row[line];
+                }
+            }
+            for (int line = 0; line < nb_lines; ++line) {
+                float *line_values = &block[static_cast<size_t>(line) * n];
+                std::copy(line_values, line_values + n, buffers.input.begin());
+                transform_line(n, buffers);
+                std::copy(buffers.output.begin(), buffers.output.end(), line_values);
+            }
+            for (int q = 0; q < n; ++q) {
+                float *row = &values[first + static_cast<size_t>(q) * strides[axis]];
+                for (int line = 0; line < nb_lines; ++line) {
+                    row[line] = block[static_cast<size_t>(line) * n + q];
+                }
+            }
+        }
+    });
+}
+
+// Squared distances, in voxels, from every voxel to the nearest voxel whose occupancy is
+// feature_inside
+static std::vector<float> squared_distances(const OccupancyGrid &occupancy, bool feature_inside) {
+    // Along x the input is still binary: the distance to the nearest feature voxel of the row
+    // comes from a scan in each direction, without the parabolas
+    auto size = occupancy.size;
+    std::vector<float> values(occupancy.inside.size());
+    ThreadPool::global().parallel_for(size.z, [&](int z) {
+        std::vector<int> offsets(size.x);
+        for (int y = 0; y < size.y; ++y) {
+            size_t first = (static_cast<size_t>(z) * size.y + y) * size.x;
+            auto is_feature = [&](int x) {
+                return (occupancy.inside[first + x] != 0) == feature_inside;
+            };
+            int previous = -1;
+            for (int x = 0; x < size.x; ++x) {
+                previous = is_feature(x) ? x : previous;
+                offsets[x] = previous >= 0 ? x - previous : -1;
+            }
+            int next = -1;
+            for (int x = size.x - 1; x >= 0; --x) {
+                next = is_feature(x) ? x : next;
+                if (next >= 0 && (offsets[x] < 0 || next - x < offsets[x])) {
+                    offsets[x] = next - x;
+                }
+                float offset = static_cast<float>(offsets[x]);
+                values[first + x] = offsets[x] >= 0 ? offset * offset : far_away;
+            }
+        }
+    });
+    for (int axis = 1; axis < 3; ++axis) {
+        transform_axis(values, size, axis);
+    }
+    return values;
+}
+
+DistanceGrid signed_distance_transform(const OccupancyGrid &occupancy) {
+    DistanceGrid grid(occupancy.size, occupancy.origin, occupancy.voxel_size);
+    float half_voxel = 0.5f * occupancy.voxel_size;
+
+    // Outside voxels measure the distance to the inside, and inside voxels to the outside
+    grid.values = squared_distances(occupancy, true);
+    auto to_outside = squared_distances(occupancy, false);
+    ThreadPool::global().parallel_for(occupancy.size.z, [&](int z) {
+        size_t first = static_cast<size_t>(z) * occupancy.size.x * occupancy.size.y;
+        size_t last = first + static_cast<size_t>(occupancy.size.x) * occupancy.size.y;
+        for (size_t i = first; i < last; ++i) {
+            if (occupancy.inside[i]) {
+                grid.values[i] = half_voxel - std::sqrt(to_outside[i]) * occupancy.voxel_size;
+            } else {
+                grid.values[i] = std::sqrt(grid.values[i]) * occupancy.voxel_size - half_voxel;
+            }
+        }
+    });
+    return grid;
+}
@@ -0,0 +1,28 @@
+#pragma once
+
+#include <cstdint>
+#include <string>
+#include <vector>
+
+#include <glm/glm.hpp>
+
+#include "distance_grid.hpp"
+
+/** Inside/outside voxel grid, laid out like DistanceGrid (non-zero means inside) */
+struct OccupancyGrid {
+    glm::ivec3 size;
+    glm::vec3 origin;
+    float voxel_size;
+    std::vector<uint8_t> inside;
+};
+
+/** Read a raw file of size.x * size.y * size.z bytes, x-fastest */
+OccupancyGrid load_occupancy(const std::string &path, glm::ivec3 size, glm::vec3 origin,
+                             float voxel_size);
+
+/** Exact signed Euclidean distance transform of an occupancy grid, with the separable
+ * linear-time algorithm of Felzenszwalb and Huttenlocher, parallelized across rows.
+ * The surface is taken halfway between inside and outside voxel centers, so voxels next to
+ * the boundary get +-voxel_size / 2. Baking a GridField of the result at the same resolution
+ * goes through the usual Block quantization. The grid comes back in the linear layout. */
+DistanceGrid signed_distance_transform(const OccupancyGrid &occupancy);
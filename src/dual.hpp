@@ -0,0 +1,124 @@
+#pragma once
+
+#include <cmath>
+#include <cstddef>
+
+#include "simd.hpp"
+
+/** Forward-mode dual number carrying a value and its gradient with respect to the position.
+ * T is float or FloatBatch, so gradients can be computed on vector lanes as well. */
+template <typename T> struct Dual {
+    T value;
+    T dx;
+    T dy;
+    T dz;
+
+    /** Position coordinate along axis (0, 1 or 2), seeded with a unit derivative */
+    static Dual variable(T value, int axis) {
+        auto zero = splat<T>(0.0f);
+        auto one = splat<T>(1.0f);
+        return {value, axis == 0 ? one : zero, axis == 1 ? one : zero, axis == 2 ? one : zero};
+    }
+};
+
+template <typename T> Dual<T> operator+(Dual<T> a, Dual<T> b) {
+    return {a.value + b.value, a.dx + b.dx, a.dy + b.dy, a.dz + b.dz};
+}
+template <typename T> Dual<T> operator-(Dual<T> a, Dual<T> b) {
+    return {a.value - b.value, a.dx - b.dx, a.dy - b.dy, a.dz - b.dz};
+}
+template <typename T> Dual<T> operator*(Dual<T> a, Dual<T> b) {
+    return {a.value * b.value, a.dx * b.value + a.value * b.dx, a.dy * b.value + a.value * b.dy,
+            a.dz * b.value + a.value * b.dz};
+}
+template <typename T> Dual<T> operator/(Dual<T> a, Dual<T> b) {
+    auto inverse = splat<T>(1.0f) / b.value;
+    auto quotient = a.value * inverse;
+    return {quotient, (a.dx - quotient * b.dx) * inverse, (a.dy - quotient * b.dy) * inverse,
+            (a.dz - quotient * b.dz) * inverse};
+}
+template <typename T> Dual<T> operator-(Dual<T> a) { return {-a.value, -a.dx, -a.dy, -a.dz}; }
+
+// Operations with constants (float or T) on either side
+template <typename T, typename S> Dual<T> operator+(Dual<T> a, S b) {
+    return {a.value + b, a.dx, a.dy, a.dz};
+}
+template <typename T, typename S> Dual<T> operator-(Dual<T> a, S b) {
+    return {a.value - b, a.dx, a.dy, a.dz};
+}
+template <typename T, typename S> Dual<T> operator*(Dual<T> a, S b) {
+    return {a.value * b, a.dx * b, a.dy * b, a.dz * b};
+}
+template <typename T, typename S> Dual<T> operator/(Dual<T> a, S b) {
+    return a * (1.0f / b);
+}
+template <typename T, typename S> Dual<T> operator+(S a, Dual<T> b) { return b + a; }
+template <typename T, typename S> Dual<T> operator-(S a, Dual<T> b) { return -b + a; }
+template <typename T, typename S> Dual<T> operator*(S a, Dual<T> b) { return b * a; }
+
+template <typename T> Dual<T> sqrt(Dual<T> a) {
+    using std::sqrt;
+    auto root = sqrt(a.value);
+    // Zero derivative at zero rather than 0 * infinity, so that the gradient of a length is
+    // the zero vector at its origin
+    auto factor = select_less(splat<T>(0.0f), root, 0.5f / root, splat<T>(0.0f));
+    return {root, a.dx * factor, a.dy * factor, a.dz * factor};
+}
+
+template <typename T> Dual<T> select_less(T a, T b, Dual<T> if_less, Dual<T> otherwise) {
+    return {select_less(a, b, if_less.value, otherwise.value),
+            select_less(a, b, if_less.dx, otherwise.dx),
+            select_less(a, b, if_less.dy, otherwise.dy),
+            select_less(a, b, if_less.dz, otherwise.dz)};
+}
+
+template <typename T> Dual<T> min(Dual<T> a, Dual<T> b) {
+    return select_less(a.value, b.value, a, b);
+}
+template <typename T> Dual<T> max(Dual<T> a, Dual<T> b) {
+    return select_less(a.value, b.value, b, a);
+}
+template <typename T> Dual<T> abs(Dual<T> a) {
+    return select_less(a.value, splat<T>(0.0f), -a, a);
+}
+
+/** Same as for_each_batch, but the kernel runs on dual numbers and both the distance and its
+ * gradient are stored. */
+template <typename Kernel>
+void for_each_batch_gradient(const float *x, const float *y, const float *z, float *out,
+                             float *gradient_x, float *gradient_y, float *gradient_z,
+                             size_t count, Kernel kernel) {
+    using D = Dual<FloatBatch>;
+    constexpr size_t width = FloatBatch::width;
+    auto run = [&](const float *bx, const float *by, const float *bz, float *o, float *gx,
+                   float *gy, float *gz) {
+        D d = kernel(D::variable(FloatBatch::load(bx), 0), D::variable(FloatBatch::load(by), 1),
+                     D::variable(FloatBatch::load(bz), 2));
+        d.value.store(o);
+        d.dx.store(gx);
+        d.dy.store(gy);
+        d.dz.store(gz);
+    };
+
+    size_t i = 0;
+    for (; i + width <= count; i += width) {
+        run(x + i, y + i, z + i, out + i, gradient_x + i, gradient_y + i, gradient_z + i);
+    }
+    if (i < count) {
+        float tail_x[width] = {}, tail_y[width] = {}, tail_z[width] = {};
+        float tail_out[width], tail_gx[width], tail_gy[width], tail_gz[width];
+        size_t tail = count - i;
+        for (size_t j = 0; j < tail; ++j) {
+            tail_x[j] = x[i + j];
+            tail_y[j] = y[i + j];
+            tail_z[j] = z[i + j];
+        }
+        run(tail_x, tail_y, tail_z, tail_out, tail_gx, tail_gy, tail_gz);
+        for (size_t j = 0; j < tail; ++j) {
+            out[i + j] = tail_out[j];
+            gradient_x[i + j] = tail_gx[j];
+            gradient_y[i + j] = tail_gy[j];
+            gradient_z[i + j] = tail_gz[j];
+        }
+    }
+}
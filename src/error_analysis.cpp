@@ -0,0 +1,200 @@
+#include <algorithm>
+#include <cmath>
+#include <random>
+
+#include "error_analysis.hpp"
+
+glm::ivec3 nearest_texel(glm::vec3 position, glm::vec3 origin, float texel_size, int nb_texels) {
+    glm::ivec3 texel = glm::floor((position - origin) / texel_size);
+    return glm::clamp(texel, glm::ivec3(0), glm::ivec3(nb_texels - 1));
+}
+
+float DecodedVolume::distance(glm::vec3 position, Reconstruction reconstruction) const {
+    float texel_size = block_size / nb_texels;
+    auto value = [&](glm::ivec3 texel) {
+        texel = glm::clamp(texel, glm::ivec3(0), glm::ivec3(nb_texels - 1));
+        return distances[(static_cast<size_t>(texel.z) * nb_texels + texel.y) * nb_texels +
+                         texel.x];
+    };
+    if (reconstruction == Reconstruction::nearest) {
+        return value(nearest_texel(position, origin, texel_size, nb_texels));
+    }
+    // Texel i is centered on origin + (i + 0.5) * texel_size, and the texture clamps to edge
+    auto coordinates = (position - origin) / texel_size - 0.5f;
+    glm::ivec3 first = glm::floor(coordinates);
+    auto t = coordinates - glm::vec3(first);
+    float x00 = glm::mix(value(first), value(first + glm::ivec3(1, 0, 0)), t.x);
+    float x10 = glm::mix(value(first + glm::ivec3(0, 1, 0)), value(first + glm::ivec3(1, 1, 0)),
+                         t.x);
+    float x01 = glm::mix(value(first + glm::ivec3(0, 0, 1)), value(first + glm::ivec3(1, 0, 1)),
+                         t.x);
+    float x11 = glm::mix(value(first + glm::ivec3(0, 1, 1)), value(first + glm::ivec3(1, 1, 1)),
+                         t.x);
+    return glm::mix(glm::mix(x00, x10, t.y), glm::mix(x01, x11, t.y), t.z);
+}
+
+glm::vec3 DecodedVolume::normal(glm::vec3 position) const {
+    auto texel = nearest_texel(position, origin, block_size / nb_texels, nb_texels);
+    return normals[(static_cast<size_t>(texel.z) * nb_texels + texel.y) * nb_texels + texel.x];
+}
+
+// Positions in SoA layout with the field values and gradients at them
+struct Samples {
+    std::vector<float> x, y, z;
+    std::vector<float> distances, gradient_x, gradient_y, gradient_z;
+
+    void evaluate(const SdfField &field) {
+        distances.resize(x.size());
+        gradient_x.resize(x.size());
+        gradient_y.resize(x.size());
+        gradient_z.resize(x.size());
+        field.evaluate_gradient({x.data(), y.data(), z.data(), x.size()}, distances.data(),
+                                gradient_x.data(), gradient_y.data(), gradient_z.data());
+    }
+
+    glm::vec3 position(size_t i) const { return glm::vec3(x[i], y[i], z[i]); }
+    glm::vec3 gradient(size_t i) const {
+        return glm::vec3(gradient_x[i], gradient_y[i], gradient_z[i]);
+    }
+};
+
+// Distance from t = 0 to the closest sign change of f over [-band, band], or band if f keeps
+// its sign. Steps are small enough to see every texel crossed.
+template <typename Function> static float closest_crossing(Function f, float band, float step) {
+    float closest = band;
+    int nb_steps = static_cast<int>(std::ceil(band / step));
+    for (float direction : {-1.0f, 1.0f}) {
+        float t0 = 0.0f, f0 = f(0.0f);
+        if (f0 == 0.0f) {
+            return 0.0f;
+        }
+        for (int i = 1; i <= nb_steps && (i - 1) * step < closest; ++i) {
+            float t1 = direction * std::min(i * step, band), f1 = f(t1);
+            if ((f0 < 0.0f) != (f1 < 0.0f)) {
+                // Bisection, which also finds the jumps of a nearest reconstruction
+                for (int iteration = 0; iteration < 24; ++iteration) {
+                    float middle = 0.5f * (t0 + t1), f_middle = f(middle);
+                    if ((f0 < 0.0f) == (f_middle < 0.0f)) {
+                        t0 = middle;
+                        f0 = f_middle;
+                    } else {
+                        t1 = middle;
+                    }
+                }
+                closest = std::min(closest, std::abs(0.5f * (t0 + t1)));
+                break;
+            }
+            t0 = t1;
+            f0 = f1;
+        }
+    }
+    return closest;
+}
+
+ErrorReport analyze_volume(const SdfField &field, const DecodedVolume &volume,
+                           Reconstruction reconstruction, float band, int nb_probes,
+                           unsigned seed) {
+    std::mt19937 generator(seed);
+    std::uniform_real_distribution<float> offset(0.0f, volume.block_size);
+    Samples probes;
+    for (int i = 0; i < nb_probes; ++i) {
+        probes.x.push_back(volume.origin.x + offset(generator));
+        probes.y.push_back(volume.origin.y + offset(generator));
+        probes.z.push_back(volume.origin.z + offset(generator));
+    }
+    probes.evaluate(field);
+
+    ErrorReport report{};
+    double distance_sum = 0.0, normal_sum = 0.0, crossing_sum = 0.0;
+    size_t nb_normals = 0;
+    Samples surface;
+    for (size_t i = 0; i < probes.x.size(); ++i) {
+        if (std::abs(probes.distances[i]) > band) {
+            continue;
+        }
+        ++report.nb_probes;
+        auto position = probes.position(i);
+        float error = std::abs(volume.distance(position, reconstruction) - probes.distances[i]);
+        distance_sum += static_cast<double>(error) * error;
+        report.distance_max = std::max(report.distance_max, error);
+
+        // Normals are left at zero where the field is flat or saturated
+        auto gradient = probes.gradient(i);
+        auto normal = volume.normal(position);
+        if (glm::dot(gradient, gradient) > 0.0f && glm::dot(normal, normal) > 0.0f) {
+            float cosine = glm::dot(glm::normalize(gradient), glm::normalize(normal));
+            float angle = glm::degrees(std::acos(glm::clamp(cosine, -1.0f, 1.0f)));
+            normal_sum += static_cast<double>(angle) * angle;
+            report.normal_max = std::max(report.normal_max, angle);
+            ++nb_normals;
+        }
+        surface.x.push_back(position.x);
+        surface.y.push_back(position.y);
+        surface.z.push_back(position.z);
+    }
+
+    // Newton steps bring the probes onto the true surface
+    for (int iteration = 0; iteration < 8; ++iteration) {
+        surface.evaluate(field);
+        for (size_t i = 0; i < surface.x.size(); ++i) {
+            auto gradient = surface.gradient(i);
+            float norm2 = glm::dot(gradient, gradient);
+            if (norm2 > 0.0f) {
+                auto position = surface.position(i) - surface.distances[i] * gradient / norm2;
+                surface.x[i] = position.x;
+                surface.y[i] = position.y;
+                surface.z[i] = position.z;
+            }
+        }
+    }
+    surface.evaluate(field);
+
+    // The field only touches zero without changing sign where surfaces of a CSG tree
+    // coincide, there is no crossing to find at such points
+    float texel_size = volume.block_size / volume.nb_texels;
+    Samples sides;
+    for (size_t i = 0; i < surface.x.size(); ++i) {
+        auto gradient = surface.gradient(i);
+        auto step = glm::dot(gradient, gradient) > 0.0f
+                        ? 0.5f * texel_size * glm::normalize(gradient)
+                        : glm::vec3(0.0f);
+        for (float side : {-1.0f, 1.0f}) {
+            auto position = surface.position(i) + side * step;
+            sides.x.push_back(position.x);
+            sides.y.push_back(position.y);
+            sides.z.push_back(position.z);
+        }
+    }
+    sides.evaluate(field);
+
+    for (size_t i = 0; i < surface.x.size(); ++i) {
+        auto position = surface.position(i);
+        auto gradient = surface.gradient(i);
+        bool inside = glm::all(glm::greaterThanEqual(position, volume.origin)) &&
+                      glm::all(glm::lessThan(position, volume.origin + volume.block_size));
+        bool crossing_field =
+            (sides.distances[2 * i] < 0.0f) != (sides.distances[2 * i + 1] < 0.0f);
+        if (!inside || !crossing_field || std::abs(surface.distances[i]) > 1e-3f * texel_size ||
+            glm::dot(gradient, gradient) == 0.0f) {
+            continue;
+        }
+        auto direction = glm::normalize(gradient);
+        float crossing = closest_crossing(
+            [&](float t) { return volume.distance(position + t * direction, reconstruction); },
+            band, 0.25f * texel_size);
+        crossing_sum += static_cast<double>(crossing) * crossing;
+        report.crossing_max = std::max(report.crossing_max, crossing);
+        ++report.nb_surface_points;
+    }
+
+    if (report.nb_probes > 0) {
+        report.distance_rms = std::sqrt(distance_sum / report.nb_probes);
+    }
+    if (nb_normals > 0) {
+        report.normal_rms = std::sqrt(normal_sum / nb_normals);
+    }
+    if (report.nb_surface_points > 0) {
+        report.crossing_rms = std::sqrt(crossing_sum / report.nb_surface_points);
+    }
+    return report;
+}
@@ -0,0 +1,51 @@
+#pragma once
+
+#include <cstddef>
+#include <glm/glm.hpp>
+#include <vector>
+
+#include "sdf_field.hpp"
+
+// Accuracy of a baked block against the field it was baked from. The volume is compared
+// after decoding, so any encoding of the texels can be measured, and it is sampled the way
+// the fragment shader samples it.
+
+/** Texture filter used to read the volume back */
+enum class Reconstruction { nearest, trilinear };
+
+/** Texel the nearest filter reads at position, in a volume of nb_texels^3 texels of
+ * texel_size starting at origin, clamped to the volume as the texture clamps to edge */
+glm::ivec3 nearest_texel(glm::vec3 position, glm::vec3 origin, float texel_size, int nb_texels);
+
+/** Decoded distances and normals of a baked block, x fastest */
+struct DecodedVolume {
+    glm::vec3 origin;
+    float block_size;
+    int nb_texels;
+    std::vector<float> distances;
+    std::vector<glm::vec3> normals;
+
+    float distance(glm::vec3 position, Reconstruction reconstruction) const;
+    /** Normal of the texel containing position, as the nearest filter returns it */
+    glm::vec3 normal(glm::vec3 position) const;
+};
+
+/** Errors measured at random probes. Distances are compared at probes within the band
+ * around the surface, normals (in degrees) at the same probes where the field has a gradient.
+ * Crossing errors are the distances between points of the true surface and the zero crossing
+ * of the volume along the true normal, searched within the band; a missing crossing counts
+ * as the full band. */
+struct ErrorReport {
+    double distance_rms;
+    float distance_max;
+    double normal_rms;
+    float normal_max;
+    double crossing_rms;
+    float crossing_max;
+    size_t nb_probes;
+    size_t nb_surface_points;
+};
+
+ErrorReport analyze_volume(const SdfField &field, const DecodedVolume &volume,
+                           Reconstruction reconstruction, float band, int nb_probes,
+                           unsigned seed = 1);
@@ -0,0 +1,28 @@
+#include "gl_compute.hpp"
+
+#ifndef GL_VERSION_4_3
+PFNGLDISPATCHCOMPUTEPROC glad_glDispatchCompute = nullptr;
+PFNGLMEMORYBARRIERPROC glad_glMemoryBarrier = nullptr;
+PFNGLBINDIMAGETEXTUREPROC glad_glBindImageTexture = nullptr;
+#endif
+
+static bool loaded = false;
+
+bool load_compute_functions(GLADloadproc load) {
+    GLint major = 0, minor = 0;
+    glGetIntegerv(GL_MAJOR_VERSION, &major);
+    glGetIntegerv(GL_MINOR_VERSION, &minor);
+    if (major < 4 || (major == 4 && minor < 3)) {
+        loaded = false;
+        return false;
+    }
+
+    glad_glDispatchCompute = reinterpret_cast<PFNGLDISPATCHCOMPUTEPROC>(load("glDispatchCompute"));
+    glad_glMemoryBarrier = reinterpret_cast<PFNGLMEMORYBARRIERPROC>(load("glMemoryBarrier"));
+    glad_glBindImageTexture =
+        reinterpret_cast<PFNGLBINDIMAGETEXTUREPROC>(load("glBindImageTexture"));
+    loaded = glad_glDispatchCompute && glad_glMemoryBarrier && glad_glBindImageTexture;
+    return loaded;
+}
+
+bool compute_functions_loaded() { return loaded; }
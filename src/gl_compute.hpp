@@ -0,0 +1,35 @@
+#pragma once
+
+#include <glad/glad.hpp>
+
+// OpenGL 4.2/4.3 entry points used by compute-shader baking. The loader in external/glad only
+// covers OpenGL 3.3, so they are declared here the same way glad declares its own.
+
+#ifndef GL_VERSION_4_3
+#define GL_COMPUTE_SHADER 0x91B9
+#define GL_SHADER_IMAGE_ACCESS_BARRIER_BIT 0x00000020
+#define GL_TEXTURE_FETCH_BARRIER_BIT 0x00000008
+#define GL_TEXTURE_UPDATE_BARRIER_BIT 0x00000100
+
+typedef void(APIENTRYP PFNGLDISPATCHCOMPUTEPROC)(GLuint num_groups_x, GLuint num_groups_y,
+                                                 GLuint num_groups_z);
+typedef void(APIENTRYP PFNGLMEMORYBARRIERPROC)(GLbitfield barriers);
+typedef void(APIENTRYP PFNGLBINDIMAGETEXTUREPROC)(GLuint unit, GLuint texture, GLint level,
+                                                  GLboolean layered, GLint layer, GLenum access,
+                                                  GLenum format);
+
+extern PFNGLDISPATCHCOMPUTEPROC glad_glDispatchCompute;
+#define glDispatchCompute glad_glDispatchCompute
+extern PFNGLMEMORYBARRIERPROC glad_glMemoryBarrier;
+#define glMemoryBarrier glad_glMemoryBarrier
+extern PFNGLBINDIMAGETEXTUREPROC glad_glBindImageTexture;
+#define glBindImageTexture glad_glBindImageTexture
+#endif
+
+/** Load the compute entry points with the loader also given to gladLoadGLLoader (such as
+ * glfwGetProcAddress). Returns false when the current context is older than OpenGL 4.3 or
+ * does not expose them. */
+bool load_compute_functions(GLADloadproc load);
+
+/** Whether load_compute_functions succeeded */
+bool compute_functions_loaded();
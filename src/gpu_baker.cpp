@@ -0,0 +1,302 @@
+#include <iomanip>
+#include <iostream>
+#include <sstream>
+
+#include "gl_compute.hpp"
+#include "gpu_baker.hpp"
+#include "opengl_helper.hpp"
+
+// Invocations per work group along each axis
+static const int group_size = 4;
+
+// Primitives return the distance and its gradient, and follow the choices made by the dual
+// numbers of the CPU kernels on ties, so that both bakes agree
+static const char *bake_shader_header = R"(#version 430 core
+layout(local_size_x = GROUP_SIZE, local_size_y = GROUP_SIZE, local_size_z = GROUP_SIZE) in;
+
+#if INTERLEAVED
+layout(rgba8, binding = 0) uniform writeonly image3D sdf_image;
+#else
+layout(SDF_FORMAT, binding = 0) uniform writeonly image3D sdf_image;
+#endif
+#if NORMAL_FORMAT != 3 && !INTERLEAVED
+layout(NORMALS_QUALIFIER, binding = 1) uniform writeonly image3D normals_image;
+#endif
+
+uniform vec3 origin;
+uniform float texel_size;
+uniform ivec3 region_min;
+uniform ivec3 region_max;
+
+// Same parameters as DistanceEncoding and DistanceFormat
+uniform int distance_curve;
+uniform float distance_scale;
+uniform float distance_bias;
+uniform float distance_range;
+uniform float distance_mu;
+const int distance_format = DISTANCE_FORMAT;
+
+float code_position(float d) {
+    float position;
+    if (distance_curve == 1) {
+        d = clamp(d, -distance_range, distance_range);
+        float u = log(1.0 + distance_mu * abs(d) / distance_range) / log(1.0 + distance_mu);
+        position = sign(d) * u * distance_scale + distance_bias;
+    } else {
+        position = (d + distance_bias / distance_scale) * distance_scale;
+    }
+    return clamp(position, 0.0, 256.0);
+}
+
+// Normalized value of the distance texel, as Block::distance_texel
+float distance_texel(float d) {
+    if (distance_format == 1) {
+        return floor(min(code_position(d) * 256.0, 65535.0)) / 65535.0;
+    } else if (distance_format >= 2) {
+        return clamp(d, -MAX_DISTANCE, MAX_DISTANCE);
+    }
+    return floor(min(code_position(d), 255.0)) / 255.0;
+}
+
+vec2 octahedral_encode(vec3 n) {
+    float norm = abs(n.x) + abs(n.y) + abs(n.z);
+    if (norm == 0.0) {
+        return vec2(0.0);
+    }
+    n /= norm;
+    vec2 sign_not_zero = mix(vec2(-1.0), vec2(1.0), greaterThanEqual(n.xy, vec2(0.0)));
+    return n.z < 0.0 ? (1.0 - abs(n.yx)) * sign_not_zero : n.xy;
+}
+
+// Normal texel as encode_normal writes it (see normal_encoding.hpp), rgb8 in an RGBA8 image
+void store_normal(ivec3 texel, vec3 normal) {
+#if INTERLEAVED
+#elif NORMAL_FORMAT == 0
+    vec3 normal_code = min(floor((normal + 1.0) * 128.0), vec3(255.0));
+    imageStore(normals_image, texel, vec4(normal_code / 255.0, 1.0));
+#elif NORMAL_FORMAT == 1
+    vec2 normal_code = floor((octahedral_encode(normal) * 0.5 + 0.5) * 255.0 + 0.5);
+    imageStore(normals_image, texel, vec4(normal_code / 255.0, 0.0, 1.0));
+#elif NORMAL_FORMAT == 2
+    vec2 normal_code = floor((octahedral_encode(normal) * 0.5 + 0.5) * 65535.0 + 0.5);
+    imageStore(normals_image, texel, vec4(normal_code / 65535.0, 0.0, 1.0));
+#endif
+}
+
+// Distance and normal of a texel, with a single store when they share the RGBA8 image
+void store_texel(ivec3 texel, float distance, vec3 normal) {
+#if INTERLEAVED
+    vec3 normal_code = min(floor((normal + 1.0) * 128.0), vec3(255.0));
+    imageStore(sdf_image, texel, vec4(normal_code / 255.0, distance));
+#else
+    imageStore(sdf_image, texel, vec4(distance));
+    store_normal(texel, normal);
+#endif
+}
+
+vec4 sphere(vec3 p, vec3 center, float radius) {
+    vec3 offset = p - center;
+    float l = length(offset);
+    return vec4(l - radius, l > 0.0 ? offset / l : vec3(0.0));
+}
+
+vec4 box(vec3 p, vec3 center, vec3 half_size) {
+    vec3 offset = p - center;
+    vec3 side = mix(vec3(1.0), vec3(-1.0), lessThan(offset, vec3(0.0)));
+    vec3 q = abs(offset) - half_size;
+    vec3 outside_q = max(q, vec3(0.0));
+    float outside = length(outside_q);
+    vec3 gradient = outside > 0.0 ? side * outside_q / outside : vec3(0.0);
+    float largest = q.y < q.z ? q.z : q.y;
+    vec3 axis = q.y < q.z ? vec3(0.0, 0.0, 1.0) : vec3(0.0, 1.0, 0.0);
+    if (!(q.x < largest)) {
+        largest = q.x;
+        axis = vec3(1.0, 0.0, 0.0);
+    }
+    if (largest < 0.0) {
+        gradient += side * axis;
+    }
+    return vec4(outside + min(largest, 0.0), gradient);
+}
+
+vec4 torus(vec3 p, vec3 center, float major_radius, float minor_radius) {
+    vec3 offset = p - center;
+    float planar = length(offset.xz);
+    float ring = planar - major_radius;
+    float l = length(vec2(ring, offset.y));
+    vec3 ring_gradient = planar > 0.0 ? vec3(offset.x, 0.0, offset.z) / planar : vec3(0.0);
+    vec3 gradient = l > 0.0 ? (ring * ring_gradient + vec3(0.0, offset.y, 0.0)) / l : vec3(0.0);
+    return vec4(l - minor_radius, gradient);
+}
+
+vec4 hard_union(vec4 a, vec4 b) { return a.x < b.x ? a : b; }
+
+vec4 smooth_union(vec4 a, vec4 b, float k) {
+    float h = max(k - abs(a.x - b.x), 0.0) / k;
+    vec4 nearest = hard_union(a, b);
+    vec3 blend = 0.5 * h * (a.x < b.x ? b.yzw - a.yzw : a.yzw - b.yzw);
+    return vec4(nearest.x - h * h * 0.25 * k, nearest.yzw + blend);
+}
+
+)";
+
+static const char *bake_shader_main = R"(
+void main() {
+    ivec3 texel = region_min + ivec3(gl_GlobalInvocationID);
+    if (any(greaterThanEqual(texel, region_max))) {
+        return;
+    }
+    vec3 position = vec3(texel) * texel_size + origin + vec3(texel_size / 2.0);
+    vec4 value = scene(position);
+
+    // Same texels as the CPU distances and normals
+    vec3 normal = dot(value.yzw, value.yzw) > 0.0 ? normalize(value.yzw) : vec3(0.0);
+    store_texel(texel, distance_texel(value.x), normal);
+}
+)";
+
+// Float literal that reads back as the same float
+static std::string literal(float value) {
+    std::ostringstream stream;
+    stream << std::setprecision(9) << std::scientific << value;
+    return stream.str();
+}
+
+static std::string literal(glm::vec3 value) {
+    return "vec3(" + literal(value.x) + ", " + literal(value.y) + ", " + literal(value.z) + ")";
+}
+
+static void replace_all(std::string &text, const std::string &name, const std::string &value) {
+    auto position = text.find(name);
+    while (position != std::string::npos) {
+        text.replace(position, name.size(), value);
+        position = text.find(name);
+    }
+}
+
+// Image format qualifier of the normal texture, rgb8 being stored in RGBA8
+static const char *normals_qualifier(NormalFormat normal_format) {
+    switch (normal_format) {
+    case NormalFormat::oct_rg8:
+        return "rg8";
+    case NormalFormat::oct_rg16:
+        return "rg16";
+    case NormalFormat::rgb8:
+    case NormalFormat::none:
+        break;
+    }
+    return "rgba8";
+}
+
+std::string generate_bake_shader(const BrushField &field, DistanceFormat format,
+                                 NormalFormat normal_format, TexelLayout layout) {
+    std::ostringstream shader;
+    std::string header = bake_shader_header;
+    replace_all(header, "GROUP_SIZE", std::to_string(group_size));
+    // Image format qualifiers are the format names
+    replace_all(header, "SDF_FORMAT", distance_format_name(format));
+    replace_all(header, "DISTANCE_FORMAT", std::to_string(static_cast<int>(format)));
+    replace_all(header, "MAX_DISTANCE", literal(DistanceEncoding::max_distance));
+    replace_all(header, "NORMALS_QUALIFIER", normals_qualifier(normal_format));
+    replace_all(header, "NORMAL_FORMAT", std::to_string(static_cast<int>(normal_format)));
+    replace_all(header, "INTERLEAVED", layout == TexelLayout::interleaved ? "1" : "0");
+    shader << header;
+
+    shader << "vec4 scene(vec3 p) {\n";
+    auto &brushes = field.brush_list();
+    if (brushes.empty()) {
+        shader << "    return vec4(1e30, vec3(0.0));\n}\n";
+        shader << bake_shader_main;
+        return shader.str();
+    }
+    for (size_t i = 0; i < brushes.size(); ++i) {
+        auto &brush = brushes[i];
+        std::string call;
+        switch (brush.shape) {
+        case BrushShape::sphere:
+            call = "sphere(p, " + literal(brush.center) + ", " + literal(brush.size.x) + ")";
+            break;
+        case BrushShape::box:
+            call = "box(p, " + literal(brush.center) + ", " + literal(brush.size) + ")";
+            break;
+        case BrushShape::torus:
+            call = "torus(p, " + literal(brush.center) + ", " + literal(brush.size.x) + ", " +
+                   literal(brush.size.y) + ")";
+            break;
+        }
+        if (i == 0) {
+            shader << "    vec4 d = " << call << ";\n";
+        } else if (field.blend_radius() > 0.0f) {
+            shader << "    d = smooth_union(d, " << call << ", " << literal(field.blend_radius())
+                   << ");\n";
+        } else {
+            shader << "    d = hard_union(d, " << call << ");\n";
+        }
+    }
+    shader << "    return d;\n}\n";
+    shader << bake_shader_main;
+    return shader.str();
+}
+
+GpuBaker::GpuBaker(const BrushField &field, DistanceFormat format, NormalFormat normal_format,
+                   TexelLayout layout)
+    : format(format), normal_format(normal_format), layout(layout),
+      source(generate_bake_shader(field, format, normal_format, layout)) {
+    GLuint shader = compile_shader(source, GL_COMPUTE_SHADER);
+    program = glCreateProgram();
+    glAttachShader(program, shader);
+    glLinkProgram(program);
+    glDetachShader(program, shader);
+    glDeleteShader(shader);
+
+    GLint is_linked = 0;
+    glGetProgramiv(program, GL_LINK_STATUS, &is_linked);
+    if (is_linked == GL_FALSE) {
+        GLint length = 0;
+        glGetProgramiv(program, GL_INFO_LOG_LENGTH, &length);
+        std::string log(static_cast<size_t>(length + 1), '\0');
+        glGetProgramInfoLog(program, length, &length, &log[0]);
+        std::cerr << "Error: cannot link the bake shader\n" << log << std::endl;
+        abort();
+    }
+}
+
+GpuBaker::~GpuBaker() { glDeleteProgram(program); }
+
+bool GpuBaker::is_supported() { return compute_functions_loaded(); }
+
+const std::string &GpuBaker::shader_source() const { return source; }
+
+void GpuBaker::bake(const Texture &sdf_texture, const Texture &normals_texture, glm::vec3 origin,
+                    float block_size, int nb_texels, const DistanceEncoding &encoding,
+                    glm::ivec3 region_min, glm::ivec3 region_max) const {
+    auto extent = region_max - region_min;
+    if (glm::any(glm::lessThanEqual(extent, glm::ivec3(0)))) {
+        return;
+    }
+    glUseProgram(program);
+    glUniform3fv(glGetUniformLocation(program, "origin"), 1, &origin[0]);
+    glUniform1f(glGetUniformLocation(program, "texel_size"), block_size / nb_texels);
+    glUniform3iv(glGetUniformLocation(program, "region_min"), 1, &region_min[0]);
+    glUniform3iv(glGetUniformLocation(program, "region_max"), 1, &region_max[0]);
+    encoding.set_uniforms(program);
+    if (layout == TexelLayout::interleaved) {
+        // The normals share the RGBA8 distance texture
+        sdf_texture.bind_image(0, GL_WRITE_ONLY, GL_RGBA8);
+    } else {
+        sdf_texture.bind_image(0, GL_WRITE_ONLY, distance_internal_format(format));
+        if (normal_format == NormalFormat::rgb8) {
+            normals_texture.bind_image(1, GL_WRITE_ONLY, GL_RGBA8);
+        } else if (normal_format != NormalFormat::none) {
+            normals_texture.bind_image(1, GL_WRITE_ONLY, normal_internal_format(normal_format));
+        }
+    }
+
+    auto nb_groups = (extent + group_size - 1) / group_size;
+    glDispatchCompute(nb_groups.x, nb_groups.y, nb_groups.z);
+
+    // Later draws sample the textures, later uploads may overwrite them
+    glMemoryBarrier(GL_TEXTURE_FETCH_BARRIER_BIT | GL_TEXTURE_UPDATE_BARRIER_BIT |
+                    GL_SHADER_IMAGE_ACCESS_BARRIER_BIT);
+    glUseProgram(0);
+}
@@ -0,0 +1,52 @@
+#pragma once
+
+#include <string>
+
+#include <glad/glad.hpp>
+#include <glm/glm.hpp>
+
+#include "brush_field.hpp"
+#include "distance_encoding.hpp"
+#include "normal_encoding.hpp"
+#include "texture.hpp"
+
+/** GLSL compute shader baking the brush scene: the brush list is unrolled into the shader,
+ * every invocation evaluates one texel with its analytic gradient and stores the same texels
+ * as Block into a distance image and a normal image of the given formats (rgb8 normals in
+ * RGBA8, none without a normal image), up to the last bit of the float formats and one code of
+ * the octahedral normals, which drivers may round differently. The interleaved layout stores
+ * both in a single RGBA8 image and needs r8 and rgb8. The distance encoding is a uniform, so
+ * that one shader serves every encoding. */
+std::string generate_bake_shader(const BrushField &field, DistanceFormat format,
+                                 NormalFormat normal_format, TexelLayout layout);
+
+/** Compiled bake shader of one brush scene. Needs an OpenGL 4.3 context on which
+ * load_compute_functions succeeded (see gl_compute.hpp). */
+class GpuBaker {
+private:
+    GLuint program;
+    DistanceFormat format;
+    NormalFormat normal_format;
+    TexelLayout layout;
+    std::string source;
+
+public:
+    GpuBaker(const BrushField &field, DistanceFormat format, NormalFormat normal_format,
+             TexelLayout layout);
+    ~GpuBaker();
+    GpuBaker(const GpuBaker &) = delete;
+    GpuBaker &operator=(const GpuBaker &) = delete;
+
+    /** Whether the current context can run compute shaders */
+    static bool is_supported();
+
+    const std::string &shader_source() const;
+
+    /** Bake the texels [region_min, region_max) of a block straight into the textures, with
+     * no CPU copy. Both textures must already exist with the block size, in the distance
+     * and normal formats (RGBA8 for rgb8), except the normal texture of none. The interleaved
+     * layout only writes the RGBA8 distance texture. */
+    void bake(const Texture &sdf_texture, const Texture &normals_texture, glm::vec3 origin,
+              float block_size, int nb_texels, const DistanceEncoding &encoding,
+              glm::ivec3 region_min, glm::ivec3 region_max) const;
+};
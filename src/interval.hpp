@@ -0,0 +1,61 @@
+#pragma once
+
+#include <algorithm>
+#include <cmath>
+#include <limits>
+
+/** Closed interval of floats. Arithmetic on intervals gives bounds that contain every value
+ * the same expression can take on floats inside the inputs, which lets a whole box of
+ * positions be bounded with one evaluation. */
+struct Interval {
+    float lower;
+    float upper;
+
+    static Interval unbounded() {
+        return {-std::numeric_limits<float>::infinity(), std::numeric_limits<float>::infinity()};
+    }
+};
+
+inline Interval operator+(Interval a, Interval b) { return {a.lower + b.lower, a.upper + b.upper}; }
+inline Interval operator-(Interval a, Interval b) { return {a.lower - b.upper, a.upper - b.lower}; }
+inline Interval operator*(Interval a, Interval b) {
+    float p1 = a.lower * b.lower, p2 = a.lower * b.upper;
+    float p3 = a.upper * b.lower, p4 = a.upper * b.upper;
+    return {std::min({p1, p2, p3, p4}), std::max({p1, p2, p3, p4})};
+}
+inline Interval operator/(Interval a, Interval b) {
+    if (b.lower <= 0.0f && b.upper >= 0.0f) {
+        return Interval::unbounded();
+    }
+    return a * Interval{1.0f / b.upper, 1.0f / b.lower};
+}
+inline Interval operator-(Interval a) { return {-a.upper, -a.lower}; }
+
+inline Interval operator+(Interval a, float b) { return {a.lower + b, a.upper + b}; }
+inline Interval operator-(Interval a, float b) { return {a.lower - b, a.upper - b}; }
+inline Interval operator*(Interval a, float b) {
+    return b >= 0.0f ? Interval{a.lower * b, a.upper * b} : Interval{a.upper * b, a.lower * b};
+}
+inline Interval operator/(Interval a, float b) { return a * (1.0f / b); }
+inline Interval operator+(float a, Interval b) { return b + a; }
+inline Interval operator-(float a, Interval b) { return -b + a; }
+inline Interval operator*(float a, Interval b) { return b * a; }
+
+inline Interval sqrt(Interval a) {
+    return {std::sqrt(std::max(a.lower, 0.0f)), std::sqrt(std::max(a.upper, 0.0f))};
+}
+inline Interval min(Interval a, Interval b) {
+    return {std::min(a.lower, b.lower), std::min(a.upper, b.upper)};
+}
+inline Interval max(Interval a, Interval b) {
+    return {std::max(a.lower, b.lower), std::max(a.upper, b.upper)};
+}
+inline Interval abs(Interval a) {
+    if (a.lower >= 0.0f) {
+        return a;
+    }
+    if (a.upper <= 0.0f) {
+        return -a;
+    }
+    return {0.0f, std::max(-a.lower, a.upper)};
+}
@@ -4,17 +4,27 @@
 
 #include <algorithm>
 #include <array>
+#include <chrono>
 #include <cmath>
+#include <fstream>
 #include <initializer_list>
 #include <iomanip>
 #include <iostream>
+#include <memory>
+#include <sstream>
+#include <string>
 #include <vector>
 
 #include <glm/glm.hpp>
 #include <glm/gtc/matrix_transform.hpp>
 #include <glm/gtc/type_ptr.hpp>
 
+#include "bake_cache.hpp"
 #include "block.hpp"
+#include "gl_compute.hpp"
+#include "point_cloud_field.hpp"
+#include "redistance.hpp"
+#include "scene.hpp"
 
 // ************************************ //
 //          Global variables
@@ -25,8 +35,21 @@ int counter_drawing_loop = 0; // Counter to handle the animation
 
 auto sphere_position = glm::vec3(0.0f, 0.0f, -2.0f);
 auto sphere_radius = 0.2f;
-
-float sdf(glm::vec3 position) { return glm::distance(position, sphere_position) - sphere_radius; }
+bool animate_sphere = false;   // Move the sphere and re-bake the texels it touches every frame
+std::string scene_path;        // Optional CSG program, mesh or point cloud baked instead
+bool compile_scene = false;    // Compile the scene program to native code (see csg_jit.hpp)
+bool redistance_scene = false; // Sample the field on the texels and redistance it before baking
+bool bake_on_gpu = false;      // Bake brush scenes with a compute shader (see gpu_baker.hpp)
+bool use_bake_cache = true;    // Reuse the bakes stored on disk by earlier runs (bake_cache.hpp)
+
+// Texel format of the baked distances (r8, r16, r16f or r32f) and encoding of the r8 and r16
+// codes (fixed, voxel_band, block_range or companded), see distance_encoding.hpp, and texel
+// format of the normals (rgb8, oct_rg8, oct_rg16 or none), see normal_encoding.hpp. r8 and
+// rgb8 can be interleaved into one RGBA8 texture. Bakes are cached per format, mode and layout.
+DistanceFormat distance_format = DistanceFormat::r8;
+EncodingMode encoding_mode = EncodingMode::fixed;
+NormalFormat normal_format = NormalFormat::rgb8;
+TexelLayout texel_layout = TexelLayout::split;
 
 std::array<glm::vec3, 4> quad_primitive_vertices = {
     glm::vec3({-1.0f, -1.0f, 0.0f}), glm::vec3({-1.0f, 1.0f, 0.0f}), glm::vec3({1.0f, -1.0f, 0.0f}),
@@ -49,6 +72,8 @@ std::array<int, 12 * 3> cube_primitive_indices = {0, 2, 1, 0, 3, 2, 1, 2, 5, 2,
 // ************************************ //
 void load_data(); // Load and send data to the GPU once
 void draw_data(); // Drawing calls within the animation loop
+std::string scene_description(); // Scene file contents and settings, keying the bake cache
+void bake_scene(); // Build the field of the scene and bake it into the block
 
 glm::vec3 block_origin = glm::vec3(-0.5f) + sphere_position;
 Block block;
@@ -56,16 +81,24 @@ float volume_size = 1.0f;
 int nb_texels = 16;
 
 /** Main function, call the general functions and setup the animation loop */
-int main() {
+int main(int argc, char **argv) {
+    if (argc > 1) {
+        scene_path = argv[1];
+    }
+
     std::cout << "*** Init GLFW ***" << std::endl;
     glfw_init();
 
     std::cout << "*** Create window ***" << std::endl;
-    auto window = glfw_create_window(800, 600, "My Window");
+    auto window = glfw_create_window(800, 600, "My Window", bake_on_gpu ? 4 : 3, 3);
     glfwMakeContextCurrent(window);
 
     std::cout << "*** Init GLAD ***" << std::endl;
     glad_init();
+    auto loader = reinterpret_cast<GLADloadproc>(glfwGetProcAddress);
+    if (bake_on_gpu && !load_compute_functions(loader)) {
+        std::cerr << "Warning: no OpenGL 4.3 compute shaders, baking on the CPU" << std::endl;
+    }
 
     print_opengl_information();
 
@@ -93,6 +126,9 @@ int main() {
         }
     }
     std::cout << "*** Terminate GLFW loop ***" << std::endl;
+
+    // Delete the textures while the context is still current
+    block = Block();
 }
 
 /** Create (or load) data and send them to GPU */
@@ -123,13 +159,99 @@ void load_data() {
     glBindBuffer(GL_ARRAY_BUFFER, 0);
     glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, 0);
 
-    block = Block(block_origin, volume_size, nb_texels, &sdf);
-    block.generate_textures();
+    // A scene baked by an earlier run is mapped from the cache instead (see bake_cache.hpp)
+    auto description = scene_description();
+    BakeCache bake_cache;
+    block = Block(block_origin, volume_size, nb_texels, std::shared_ptr<const SdfField>());
+    block.set_encoding_mode(encoding_mode);
+    block.set_distance_format(distance_format);
+    block.set_normal_format(normal_format);
+    block.set_texel_layout(texel_layout);
+    auto load_start = std::chrono::steady_clock::now();
+    if (use_bake_cache && block.load_cached(bake_cache, description)) {
+        std::chrono::duration<double> duration = std::chrono::steady_clock::now() - load_start;
+        std::cout << "Loaded the bake from the cache in " << duration.count() << " s"
+                  << std::endl;
+    } else {
+        bake_scene();
+        // GPU bakes keep no CPU copy and are not stored
+        if (use_bake_cache) {
+            block.store_cached(bake_cache, description);
+        }
+    }
 
     glEnable(GL_CULL_FACE);
     glCullFace(GL_FRONT);
 }
 
+std::string scene_description() {
+    std::ostringstream description;
+    if (scene_path.empty()) {
+        description << "sphere " << std::hexfloat << sphere_position.x << ' ' << sphere_position.y
+                    << ' ' << sphere_position.z << ' ' << sphere_radius;
+    } else {
+        // Keyed on the contents, a copy of the scene under another name reuses the bake. The
+        // extension stays in, since it selects the parser.
+        std::ifstream file(scene_path, std::ios::binary);
+        description << scene_path.substr(scene_path.find_last_of('.') + 1) << '\n';
+        // Streaming an empty or unreadable file sets failbit, which would drop the settings
+        if (file && file.peek() != std::ifstream::traits_type::eof()) {
+            description << file.rdbuf();
+        }
+    }
+    description << "\ncompile " << compile_scene << " redistance " << redistance_scene;
+    return description.str();
+}
+
+void bake_scene() {
+    std::shared_ptr<const SdfField> field =
+        std::make_shared<SphereField>(sphere_position, sphere_radius);
+    if (!scene_path.empty()) {
+        field = load_scene(scene_path, block_origin, volume_size, compile_scene);
+    }
+    auto point_cloud = std::dynamic_pointer_cast<const PointCloudField>(field);
+    if (redistance_scene) {
+        // Smooth blends are not distances, restore |grad d| = 1 near the surface (see
+        // redistance.hpp). The sweeps and the trilinear reads of the bake both walk neighbours,
+        // which bricks keep in the same cache lines once the grid outgrows the cache
+        // (grid-layout-benchmark), from 256^3 on. Smaller grids are faster linear.
+        auto layout = nb_texels >= 256 ? GridLayout::bricked : GridLayout::linear;
+        auto grid = std::make_shared<DistanceGrid>(
+            DistanceGrid::for_block(block_origin, volume_size, nb_texels, layout));
+        grid->sample_field(*field);
+        float band = 4.0f * grid->voxel_size;
+        auto before = gradient_error(*grid, glm::ivec3(0), grid->size, band);
+        redistance(*grid, glm::ivec3(0), grid->size);
+        auto after = gradient_error(*grid, glm::ivec3(0), grid->size, band);
+        std::cout << "Gradient norm error before redistancing: mean " << before.mean << ", max "
+                  << before.max << "; after: mean " << after.mean << ", max " << after.max
+                  << std::endl;
+        field = std::make_shared<GridField>(grid);
+    }
+    block = Block(block_origin, volume_size, nb_texels, field);
+    block.set_encoding_mode(encoding_mode);
+    block.set_distance_format(distance_format);
+    block.set_normal_format(normal_format);
+    block.set_texel_layout(texel_layout);
+    auto bake_start = std::chrono::steady_clock::now();
+    if (bake_on_gpu) {
+        block.generate_textures_gpu();
+        glFinish();
+    } else {
+        block.generate_textures();
+    }
+    std::chrono::duration<double> bake_duration = std::chrono::steady_clock::now() - bake_start;
+    if (point_cloud) {
+        std::cout << "Answered " << point_cloud->query_count() << " neighbour queries ("
+                  << point_cloud->query_count() / bake_duration.count() << " queries/s)"
+                  << std::endl;
+    }
+    auto statistics = block.bake_statistics();
+    std::cout << "Baked " << statistics.evaluated_texels << " texels, "
+              << statistics.skipped_texels << " skipped for " << statistics.bound_evaluations
+              << " bound evaluations in " << bake_duration.count() << " s" << std::endl;
+}
+
 /** Function called within the animation loop.
         Setup uniform variables and drawing calls  */
 void draw_data() {
@@ -141,6 +263,17 @@ void draw_data() {
 
     double time = glfwGetTime();
 
+    if (animate_sphere) {
+        // Distances can change up to the saturation band around the old and new spheres
+        auto previous_position = sphere_position;
+        sphere_position = glm::vec3(0.2f * sin(time), 0.0f, -2.0f);
+        auto reach = glm::vec3(sphere_radius + Block::max_distance);
+        block.set_field(std::make_shared<SphereField>(sphere_position, sphere_radius));
+        block.mark_dirty(glm::min(previous_position, sphere_position) - reach,
+                         glm::max(previous_position, sphere_position) + reach);
+        block.update_textures();
+    }
+
     // ******************************** //
     // Draw data
     // ******************************** //
@@ -174,6 +307,8 @@ void draw_data() {
     glUniform3fv(glGetUniformLocation(shader_program, "volume_origin"), 1, &block_origin[0]);
     glUniform1f(glGetUniformLocation(shader_program, "volume_size"), volume_size);
     glUniform1f(glGetUniformLocation(shader_program, "nb_texels"), nb_texels);
+    block.set_distance_uniforms(shader_program);
+    block.set_normal_uniforms(shader_program);
 
     // Draw call
     glDrawElements(GL_TRIANGLES, quad_primitive_indices.size(), GL_UNSIGNED_INT, 0);
@@ -0,0 +1,338 @@
+#include <algorithm>
+#include <cctype>
+#include <cerrno>
+#include <cstdint>
+#include <cstdlib>
+#include <cstring>
+#include <fstream>
+#include <iostream>
+#include <limits>
+#include <sstream>
+
+#include "mesh.hpp"
+
+static std::ifstream open_mesh_file(const std::string &path, std::ios::openmode mode) {
+    std::ifstream stream(path, mode);
+    if (!stream.is_open()) {
+        std::cerr << "\n\nError: cannot open file [" << path << "]" << std::endl;
+        abort();
+    }
+    return stream;
+}
+
+// Append a polygon as a triangle fan
+static void add_polygon(Mesh &mesh, const std::vector<int> &polygon) {
+    for (size_t i = 2; i < polygon.size(); ++i) {
+        mesh.triangles.push_back({polygon[0], polygon[i - 1], polygon[i]});
+    }
+}
+
+static void check_indices(const Mesh &mesh, const std::string &path) {
+    int nb_vertices = static_cast<int>(mesh.vertices.size());
+    for (auto &triangle : mesh.triangles) {
+        for (int corner = 0; corner < 3; ++corner) {
+            if (triangle[corner] < 0 || triangle[corner] >= nb_vertices) {
+                std::cerr << "Error: mesh [" << path << "] references vertex "
+                          << triangle[corner] << " out of " << nb_vertices << std::endl;
+                abort();
+            }
+        }
+    }
+}
+
+Mesh Mesh::load(const std::string &path) {
+    auto dot = path.find_last_of('.');
+    auto extension = dot == std::string::npos ? std::string() : path.substr(dot + 1);
+    std::transform(extension.begin(), extension.end(), extension.begin(),
+                   [](unsigned char c) { return std::tolower(c); });
+    if (extension == "obj") {
+        return load_obj(path);
+    }
+    if (extension == "ply") {
+        return load_ply(path);
+    }
+    if (extension == "xyz") {
+        return load_xyz(path);
+    }
+    std::cerr << "Error: unknown mesh format [" << path << "], expected .obj, .ply or .xyz"
+              << std::endl;
+    abort();
+}
+
+Mesh Mesh::load_obj(const std::string &path) {
+    auto stream = open_mesh_file(path, std::ios::in);
+    Mesh mesh;
+    std::string line;
+    std::vector<int> polygon;
+    size_t line_number = 0;
+    while (std::getline(stream, line)) {
+        ++line_number;
+        std::istringstream words(line);
+        std::string keyword;
+        words >> keyword;
+        if (keyword == "v") {
+            glm::vec3 vertex;
+            words >> vertex.x >> vertex.y >> vertex.z;
+            mesh.vertices.push_back(vertex);
+        } else if (keyword == "f") {
+            // Corners are written v, v/vt, v//vn or v/vt/vn, negative indices count from the end
+            polygon.clear();
+            std::string corner;
+            while (words >> corner) {
+                // The vertex index is the whole corner up to the first slash, and never 0
+                char *end = nullptr;
+                errno = 0;
+                long index = std::strtol(corner.c_str(), &end, 10);
+                if (end == corner.c_str() || (*end != '\0' && *end != '/') || index == 0 ||
+                    errno == ERANGE || index < std::numeric_limits<int>::min() ||
+                    index > std::numeric_limits<int>::max()) {
+                    std::cerr << "Error: mesh [" << path << ":" << line_number
+                              << "] has a malformed face corner [" << corner << "]" << std::endl;
+                    abort();
+                }
+                int vertex = static_cast<int>(index);
+                polygon.push_back(vertex < 0 ? static_cast<int>(mesh.vertices.size()) + vertex
+                                             : vertex - 1);
+            }
+            add_polygon(mesh, polygon);
+        }
+    }
+    check_indices(mesh, path);
+    return mesh;
+}
+
+namespace {
+
+struct PlyProperty {
+    std::string name;
+    std::string type;
+    std::string count_type; // Empty unless the property is a list
+};
+
+struct PlyElement {
+    std::string name;
+    size_t count;
+    std::vector<PlyProperty> properties;
+};
+
+size_t ply_type_size(const std::string &type) {
+    if (type == "char" || type == "uchar" || type == "int8" || type == "uint8") {
+        return 1;
+    }
+    if (type == "short" || type == "ushort" || type == "int16" || type == "uint16") {
+        return 2;
+    }
+    if (type == "int" || type == "uint" || type == "float" || type == "int32" ||
+        type == "uint32" || type == "float32") {
+        return 4;
+    }
+    if (type == "double" || type == "float64") {
+        return 8;
+    }
+    std::cerr << "Error: unknown PLY property type [" << type << "]" << std::endl;
+    abort();
+}
+
+/** Reads PLY scalars from either encoding */
+class PlyReader {
+private:
+    std::istream &stream;
+    bool ascii;
+    bool swap_bytes;
+
+public:
+    PlyReader(std::istream &stream, bool ascii, bool swap_bytes)
+        : stream(stream), ascii(ascii), swap_bytes(swap_bytes) {}
+
+    double read(const std::string &type) {
+        if (ascii) {
+            double value = 0.0;
+            stream >> value;
+            return value;
+        }
+        unsigned char bytes[8];
+        size_t size = ply_type_size(type);
+        stream.read(reinterpret_cast<char *>(bytes), size);
+        if (swap_bytes) {
+            std::reverse(bytes, bytes + size);
+        }
+        if (type == "char" || type == "int8") {
+            return static_cast<int8_t>(bytes[0]);
+        }
+        if (type == "uchar" || type == "uint8") {
+            return bytes[0];
+        }
+        return decode(type, bytes);
+    }
+
+private:
+    template <typename T> static double as(const unsigned char *bytes) {
+        T value;
+        std::memcpy(&value, bytes, sizeof(T));
+        return static_cast<double>(value);
+    }
+
+    static double decode(const std::string &type, const unsigned char *bytes) {
+        if (type == "short" || type == "int16") {
+            return as<int16_t>(bytes);
+        }
+        if (type == "ushort" || type == "uint16") {
+            return as<uint16_t>(bytes);
+        }
+        if (type == "int" || type == "int32") {
+            return as<int32_t>(bytes);
+        }
+        if (type == "uint" || type == "uint32") {
+            return as<uint32_t>(bytes);
+        }
+        if (type == "float" || type == "float32") {
+            return as<float>(bytes);
+        }
+        return as<double>(bytes);
+    }
+};
+
+} // namespace
+
+Mesh Mesh::load_ply(const std::string &path) {
+    auto stream = open_mesh_file(path, std::ios::in | std::ios::binary);
+
+    // Header
+    std::string line, format;
+    std::vector<PlyElement> elements;
+    std::getline(stream, line);
+    if (line.compare(0, 3, "ply") != 0) {
+        std::cerr << "Error: [" << path << "] is not a PLY file" << std::endl;
+        abort();
+    }
+    while (std::getline(stream, line)) {
+        if (!line.empty() && line.back() == '\r') {
+            line.pop_back();
+        }
+        std::istringstream words(line);
+        std::string keyword;
+        words >> keyword;
+        if (keyword == "format") {
+            words >> format;
+        } else if (keyword == "element") {
+            PlyElement element;
+            words >> element.name >> element.count;
+            elements.push_back(element);
+        } else if (keyword == "property" && !elements.empty()) {
+            PlyProperty property;
+            words >> property.type;
+            if (property.type == "list") {
+                words >> property.count_type >> property.type;
+            }
+            words >> property.name;
+            elements.back().properties.push_back(property);
+        } else if (keyword == "end_header") {
+            break;
+        }
+    }
+
+    bool ascii = format == "ascii";
+    bool big_endian = format == "binary_big_endian";
+    if (!ascii && !big_endian && format != "binary_little_endian") {
+        std::cerr << "Error: unknown PLY format [" << format << "] in [" << path << "]"
+                  << std::endl;
+        abort();
+    }
+    uint16_t probe = 1;
+    bool host_little_endian = *reinterpret_cast<unsigned char *>(&probe) == 1;
+    PlyReader reader(stream, ascii, !ascii && big_endian == host_little_endian);
+
+    // Body, keeping vertex positions and face index lists
+    Mesh mesh;
+    std::vector<int> polygon;
+    for (auto &element : elements) {
+        for (size_t item = 0; item < element.count; ++item) {
+            glm::vec3 vertex(0.0f), normal(0.0f);
+            bool has_normal = false;
+            for (auto &property : element.properties) {
+                if (!property.count_type.empty()) {
+                    auto count = static_cast<size_t>(reader.read(property.count_type));
+                    polygon.clear();
+                    for (size_t i = 0; i < count; ++i) {
+                        polygon.push_back(static_cast<int>(reader.read(property.type)));
+                    }
+                    if (element.name == "face" &&
+                        (property.name == "vertex_indices" || property.name == "vertex_index")) {
+                        add_polygon(mesh, polygon);
+                    }
+                    continue;
+                }
+                auto value = static_cast<float>(reader.read(property.type));
+                auto &name = property.name;
+                if (name.size() == 1 && name[0] >= 'x' && name[0] <= 'z') {
+                    vertex[name[0] - 'x'] = value;
+                } else if (name.size() == 2 && name[0] == 'n' && name[1] >= 'x' && name[1] <= 'z') {
+                    normal[name[1] - 'x'] = value;
+                    has_normal = true;
+                }
+            }
+            if (element.name == "vertex") {
+                mesh.vertices.push_back(vertex);
+                if (has_normal) {
+                    mesh.normals.push_back(normal);
+                }
+            }
+        }
+    }
+    if (!stream) {
+        std::cerr << "Error: PLY file [" << path << "] is truncated" << std::endl;
+        abort();
+    }
+    check_indices(mesh, path);
+    return mesh;
+}
+
+Mesh Mesh::load_xyz(const std::string &path) {
+    auto stream = open_mesh_file(path, std::ios::in);
+    Mesh mesh;
+    std::string line;
+    while (std::getline(stream, line)) {
+        std::istringstream words(line);
+        glm::vec3 vertex, normal;
+        if (words >> vertex.x >> vertex.y >> vertex.z >> normal.x >> normal.y >> normal.z) {
+            mesh.vertices.push_back(vertex);
+            mesh.normals.push_back(normal);
+        }
+    }
+    return mesh;
+}
+
+glm::vec3 Mesh::bounds_min() const {
+    glm::vec3 bounds(std::numeric_limits<float>::max());
+    for (auto &vertex : vertices) {
+        bounds = glm::min(bounds, vertex);
+    }
+    return bounds;
+}
+
+glm::vec3 Mesh::bounds_max() const {
+    glm::vec3 bounds(-std::numeric_limits<float>::max());
+    for (auto &vertex : vertices) {
+        bounds = glm::max(bounds, vertex);
+    }
+    return bounds;
+}
+
+void Mesh::fit_to_box(glm::vec3 box_min, glm::vec3 box_max, float fill_ratio) {
+    if (vertices.empty()) {
+        return;
+    }
+    auto mesh_min = bounds_min();
+    auto mesh_max = bounds_max();
+    auto mesh_extent = mesh_max - mesh_min;
+    auto box_extent = box_max - box_min;
+    float largest = std::max({mesh_extent.x, mesh_extent.y, mesh_extent.z});
+    float scale = largest > 0.0f
+                      ? fill_ratio * std::min({box_extent.x, box_extent.y, box_extent.z}) / largest
+                      : 1.0f;
+    auto mesh_center = (mesh_min + mesh_max) * 0.5f;
+    auto box_center = (box_min + box_max) * 0.5f;
+    for (auto &vertex : vertices) {
+        vertex = (vertex - mesh_center) * scale + box_center;
+    }
+}
@@ -0,0 +1,28 @@
+#pragma once
+
+#include <string>
+#include <vector>
+
+#include <glm/glm.hpp>
+
+/** Indexed triangle mesh. Without triangles, an oriented point cloud. */
+struct Mesh {
+    std::vector<glm::vec3> vertices;
+    std::vector<glm::vec3> normals; // Per-vertex normals, empty unless the file has them
+    std::vector<glm::ivec3> triangles;
+
+    /** Load a Wavefront OBJ, a PLY (ASCII or binary) or an XYZ point file, chosen from the
+     * extension. Polygons are split into triangle fans, other attributes are ignored. */
+    static Mesh load(const std::string &path);
+    static Mesh load_obj(const std::string &path);
+    static Mesh load_ply(const std::string &path);
+    /** Text file with one "x y z nx ny nz" point per line */
+    static Mesh load_xyz(const std::string &path);
+
+    glm::vec3 bounds_min() const;
+    glm::vec3 bounds_max() const;
+
+    /** Uniformly scale and move the mesh so that it is centered in the box and fills
+     * fill_ratio of its smallest side */
+    void fit_to_box(glm::vec3 box_min, glm::vec3 box_max, float fill_ratio);
+};
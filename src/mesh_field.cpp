@@ -0,0 +1,408 @@
+#include <algorithm>
+#include <array>
+#include <cmath>
+#include <limits>
+
+#include "mesh_field.hpp"
+
+// Leaves stop splitting at min_leaf triangles, and may keep up to max_leaf triangles when the
+// surface area heuristic finds no split worth it
+static const int min_leaf = 2;
+static const int max_leaf = 8;
+static const int nb_bins = 16;
+
+// A node farther than this many radii only contributes through its dipole to winding numbers
+static const float dipole_distance = 3.0f;
+
+static const float pi = 3.14159265358979f;
+
+// Depth of the traversal stacks, the hierarchy stops splitting before overflowing them
+static const int stack_depth = 64;
+
+static float half_area(glm::vec3 bounds_min, glm::vec3 bounds_max) {
+    auto extent = glm::max(bounds_max - bounds_min, glm::vec3(0.0f));
+    return extent.x * extent.y + extent.y * extent.z + extent.z * extent.x;
+}
+
+static float box_squared_distance(glm::vec3 position, glm::vec3 bounds_min,
+                                  glm::vec3 bounds_max) {
+    auto gap = glm::max(glm::max(bounds_min - position, position - bounds_max), glm::vec3(0.0f));
+    return glm::dot(gap, gap);
+}
+
+static float box_box_squared_distance(glm::vec3 a_min, glm::vec3 a_max, glm::vec3 b_min,
+                                      glm::vec3 b_max) {
+    auto gap = glm::max(glm::max(a_min - b_max, b_min - a_max), glm::vec3(0.0f));
+    return glm::dot(gap, gap);
+}
+
+// Closest point of triangle abc to p, by Voronoi regions (Ericson, Real-Time Collision
+// Detection, 5.1.5)
+static glm::vec3 closest_point(glm::vec3 p, glm::vec3 a, glm::vec3 b, glm::vec3 c) {
+    auto ab = b - a, ac = c - a, ap = p - a;
+    float d1 = glm::dot(ab, ap), d2 = glm::dot(ac, ap);
+    if (d1 <= 0.0f && d2 <= 0.0f) {
+        return a;
+    }
+    auto bp = p - b;
+    float d3 = glm::dot(ab, bp), d4 = glm::dot(ac, bp);
+    if (d3 >= 0.0f && d4 <= d3) {
+        return b;
+    }
+    float vc = d1 * d4 - d3 * d2;
+    if (vc <= 0.0f && d1 >= 0.0f && d3 <= 0.0f) {
+        return a + ab * (d1 / (d1 - d3));
+    }
+    auto cp = p - c;
+    float d5 = glm::dot(ab, cp), d6 = glm::dot(ac, cp);
+    if (d6 >= 0.0f && d5 <= d6) {
+        return c;
+    }
+    float vb = d5 * d2 - d1 * d6;
+    if (vb <= 0.0f && d2 >= 0.0f && d6 <= 0.0f) {
+        return a + ac * (d2 / (d2 - d6));
+    }
+    float va = d3 * d6 - d5 * d4;
+    if (va <= 0.0f && d4 - d3 >= 0.0f && d5 - d6 >= 0.0f) {
+        return b + (c - b) * ((d4 - d3) / ((d4 - d3) + (d5 - d6)));
+    }
+    float sum = va + vb + vc;
+    if (!(sum > 0.0f)) {
+        // Degenerate triangle, every edge test above failed by rounding
+        return a;
+    }
+    return a + ab * (vb / sum) + ac * (vc / sum);
+}
+
+// Signed solid angle of triangle abc seen from p (Van Oosterom and Strackee)
+static float solid_angle(glm::vec3 p, glm::vec3 a, glm::vec3 b, glm::vec3 c) {
+    a -= p;
+    b -= p;
+    c -= p;
+    float la = glm::length(a), lb = glm::length(b), lc = glm::length(c);
+    float numerator = glm::dot(a, glm::cross(b, c));
+    float denominator =
+        la * lb * lc + glm::dot(a, b) * lc + glm::dot(b, c) * la + glm::dot(c, a) * lb;
+    return 2.0f * std::atan2(numerator, denominator);
+}
+
+MeshField::MeshField(const Mesh &mesh) {
+    std::vector<Triangle> unordered;
+    std::vector<glm::vec3> centroids;
+    unordered.reserve(mesh.triangles.size());
+    centroids.reserve(mesh.triangles.size());
+    for (auto &triangle : mesh.triangles) {
+        Triangle corners{mesh.vertices[triangle.x], mesh.vertices[triangle.y],
+                         mesh.vertices[triangle.z]};
+        unordered.push_back(corners);
+        centroids.push_back((corners.a + corners.b + corners.c) / 3.0f);
+    }
+
+    std::vector<int> order(unordered.size());
+    for (size_t i = 0; i < order.size(); ++i) {
+        order[i] = static_cast<int>(i);
+    }
+    if (!unordered.empty()) {
+        nodes.reserve(2 * unordered.size() / min_leaf);
+        dipoles.reserve(nodes.capacity());
+        build(order, centroids, unordered, 0, static_cast<int>(unordered.size()), 0);
+    }
+
+    // Store the triangles in leaf order, so that a leaf reads consecutive memory
+    triangles.reserve(unordered.size());
+    for (int i : order) {
+        triangles.push_back(unordered[i]);
+    }
+}
+
+int MeshField::build(std::vector<int> &order, const std::vector<glm::vec3> &centroids,
+                     const std::vector<Triangle> &unordered, int first, int count, int depth) {
+    glm::vec3 bounds_min(std::numeric_limits<float>::max());
+    glm::vec3 bounds_max(-std::numeric_limits<float>::max());
+    glm::vec3 centers_min = bounds_min, centers_max = bounds_max;
+    Dipole dipole{glm::vec3(0.0f), 0.0f, glm::vec3(0.0f)};
+    float total_area = 0.0f;
+    for (int i = first; i < first + count; ++i) {
+        auto &triangle = unordered[order[i]];
+        bounds_min = glm::min(bounds_min, glm::min(triangle.a, glm::min(triangle.b, triangle.c)));
+        bounds_max = glm::max(bounds_max, glm::max(triangle.a, glm::max(triangle.b, triangle.c)));
+        centers_min = glm::min(centers_min, centroids[order[i]]);
+        centers_max = glm::max(centers_max, centroids[order[i]]);
+
+        auto area_normal = 0.5f * glm::cross(triangle.b - triangle.a, triangle.c - triangle.a);
+        float area = glm::length(area_normal);
+        dipole.area_normal += area_normal;
+        dipole.center += area * centroids[order[i]];
+        total_area += area;
+    }
+
+    // The dipole sits at the area-weighted centroid, its radius covers every corner
+    dipole.center = total_area > 0.0f ? dipole.center / total_area
+                                      : (bounds_min + bounds_max) * 0.5f;
+    for (int i = first; i < first + count; ++i) {
+        auto &triangle = unordered[order[i]];
+        for (auto corner : {triangle.a, triangle.b, triangle.c}) {
+            dipole.radius = std::max(dipole.radius, glm::length(corner - dipole.center));
+        }
+    }
+
+    int index = static_cast<int>(nodes.size());
+    nodes.push_back({bounds_min, bounds_max, first, count});
+    dipoles.push_back(dipole);
+    if (count <= min_leaf || depth + 2 >= stack_depth) {
+        return index;
+    }
+
+    // Binned surface area heuristic over the three axes, a traversal step costing as much as
+    // one triangle test
+    float parent_area = std::max(half_area(bounds_min, bounds_max),
+                                 std::numeric_limits<float>::min());
+    float best_cost = std::numeric_limits<float>::max();
+    int best_axis = -1, best_split = 0;
+    auto centers_extent = centers_max - centers_min;
+    auto bin_of = [&](int triangle, int axis) {
+        float t = (centroids[triangle][axis] - centers_min[axis]) / centers_extent[axis];
+        return std::min(static_cast<int>(t * nb_bins), nb_bins - 1);
+    };
+    for (int axis = 0; axis < 3; ++axis) {
+        if (!(centers_extent[axis] > 0.0f)) {
+            continue;
+        }
+        std::array<glm::vec3, nb_bins> bin_min, bin_max;
+        std::array<int, nb_bins> bin_count{};
+        bin_min.fill(glm::vec3(std::numeric_limits<float>::max()));
+        bin_max.fill(glm::vec3(-std::numeric_limits<float>::max()));
+        for (int i = first; i < first + count; ++i) {
+            auto &triangle = unordered[order[i]];
+            int bin = bin_of(order[i], axis);
+            bin_min[bin] =
+                glm::min(bin_min[bin], glm::min(triangle.a, glm::min(triangle.b, triangle.c)));
+            bin_max[bin] =
+                glm::max(bin_max[bin], glm::max(triangle.a, glm::max(triangle.b, triangle.c)));
+            ++bin_count[bin];
+        }
+
+        // Cost of the triangles right of each split, then sweep from the left
+        std::array<float, nb_bins> right_cost{};
+        glm::vec3 sweep_min(std::numeric_limits<float>::max());
+        glm::vec3 sweep_max(-std::numeric_limits<float>::max());
+        int sweep_count = 0;
+        for (int split = nb_bins - 1; split > 0; --split) {
+            sweep_min = glm::min(sweep_min, bin_min[split]);
+            sweep_max = glm::max(sweep_max, bin_max[split]);
+            sweep_count += bin_count[split];
+            right_cost[split] = sweep_count ? half_area(sweep_min, sweep_max) * sweep_count : 0.0f;
+        }
+        sweep_min = glm::vec3(std::numeric_limits<float>::max());
+        sweep_max = glm::vec3(-std::numeric_limits<float>::max());
+        sweep_count = 0;
+        for (int split = 1; split < nb_bins; ++split) {
+            sweep_min = glm::min(sweep_min, bin_min[split - 1]);
+            sweep_max = glm::max(sweep_max, bin_max[split - 1]);
+            sweep_count += bin_count[split - 1];
+            if (sweep_count == 0 || sweep_count == count) {
+                continue;
+            }
+            float cost = 1.0f + (half_area(sweep_min, sweep_max) * sweep_count +
+                                 right_cost[split]) / parent_area;
+            if (cost < best_cost) {
+                best_cost = cost;
+                best_axis = axis;
+                best_split = split;
+            }
+        }
+    }
+    if (best_axis < 0 || (best_cost >= count && count <= max_leaf)) {
+        // Either every centroid coincides, or splitting does not pay off
+        return index;
+    }
+
+    auto begin = order.begin() + first;
+    auto middle = std::partition(begin, begin + count, [&](int triangle) {
+        return bin_of(triangle, best_axis) < best_split;
+    });
+    int left_count = static_cast<int>(middle - begin);
+
+    // The left child is stored right after its parent, the right one after the left subtree
+    build(order, centroids, unordered, first, left_count, depth + 1);
+    int right =
+        build(order, centroids, unordered, first + left_count, count - left_count, depth + 1);
+    nodes[index].first = right;
+    nodes[index].count = 0;
+    return index;
+}
+
+size_t MeshField::triangle_count() const { return triangles.size(); }
+
+size_t MeshField::node_count() const { return nodes.size(); }
+
+float MeshField::squared_distance(glm::vec3 position, int &closest) const {
+    // Start from the previous closest triangle: neighbouring queries of a brick mostly share
+    // it, which prunes most of the hierarchy from the start
+    float best = std::numeric_limits<float>::infinity();
+    if (closest >= 0) {
+        auto &triangle = triangles[closest];
+        auto offset = position - closest_point(position, triangle.a, triangle.b, triangle.c);
+        best = glm::dot(offset, offset);
+    }
+
+    std::array<std::pair<int, float>, stack_depth> stack;
+    int stack_size = 0;
+    if (!nodes.empty()) {
+        stack[stack_size++] = {0, box_squared_distance(position, nodes[0].bounds_min,
+                                                       nodes[0].bounds_max)};
+    }
+    while (stack_size > 0) {
+        auto entry = stack[--stack_size];
+        if (entry.second >= best) {
+            continue;
+        }
+        auto &node = nodes[entry.first];
+        if (node.count > 0) {
+            for (int i = node.first; i < node.first + node.count; ++i) {
+                auto &triangle = triangles[i];
+                if (box_squared_distance(position,
+                                         glm::min(triangle.a, glm::min(triangle.b, triangle.c)),
+                                         glm::max(triangle.a, glm::max(triangle.b, triangle.c))) >=
+                    best) {
+                    continue;
+                }
+                auto offset =
+                    position - closest_point(position, triangle.a, triangle.b, triangle.c);
+                float candidate = glm::dot(offset, offset);
+                if (candidate < best) {
+                    best = candidate;
+                    closest = i;
+                }
+            }
+            continue;
+        }
+
+        // Push the far child first so that the near one is visited next
+        int left = entry.first + 1, right = node.first;
+        float left_distance =
+            box_squared_distance(position, nodes[left].bounds_min, nodes[left].bounds_max);
+        float right_distance =
+            box_squared_distance(position, nodes[right].bounds_min, nodes[right].bounds_max);
+        if (left_distance < right_distance) {
+            std::swap(left, right);
+            std::swap(left_distance, right_distance);
+        }
+        if (left_distance < best) {
+            stack[stack_size++] = {left, left_distance};
+        }
+        if (right_distance < best) {
+            stack[stack_size++] = {right, right_distance};
+        }
+    }
+    return best;
+}
+
+float MeshField::winding_number(glm::vec3 position) const {
+    float total_angle = 0.0f;
+    std::array<int, stack_depth> stack;
+    int stack_size = 0;
+    if (!nodes.empty()) {
+        stack[stack_size++] = 0;
+    }
+    while (stack_size > 0) {
+        int index = stack[--stack_size];
+        auto &dipole = dipoles[index];
+        auto offset = dipole.center - position;
+        float distance = glm::length(offset);
+        if (distance > dipole_distance * dipole.radius) {
+            // Far away, the triangles look like a single oriented area
+            total_angle += glm::dot(offset, dipole.area_normal) / (distance * distance * distance);
+            continue;
+        }
+        auto &node = nodes[index];
+        if (node.count > 0) {
+            for (int i = node.first; i < node.first + node.count; ++i) {
+                auto &triangle = triangles[i];
+                total_angle += solid_angle(position, triangle.a, triangle.b, triangle.c);
+            }
+            continue;
+        }
+        stack[stack_size++] = index + 1;
+        stack[stack_size++] = node.first;
+    }
+    return total_angle / (4.0f * pi);
+}
+
+void MeshField::evaluate(PositionSpan positions, float *distances) const {
+    int closest = -1;
+    for (size_t i = 0; i < positions.count; ++i) {
+        glm::vec3 position(positions.x[i], positions.y[i], positions.z[i]);
+        float distance = std::sqrt(squared_distance(position, closest));
+        distances[i] = winding_number(position) > 0.5f ? -distance : distance;
+    }
+}
+
+void MeshField::evaluate_gradient(PositionSpan positions, float *distances, float *gradient_x,
+                                  float *gradient_y, float *gradient_z) const {
+    // The gradient of the distance points away from the closest point, flipped inside
+    int closest = -1;
+    for (size_t i = 0; i < positions.count; ++i) {
+        glm::vec3 position(positions.x[i], positions.y[i], positions.z[i]);
+        float distance = std::sqrt(squared_distance(position, closest));
+        glm::vec3 gradient(0.0f);
+        if (closest >= 0 && distance > 0.0f) {
+            auto &triangle = triangles[closest];
+            gradient = (position - closest_point(position, triangle.a, triangle.b, triangle.c)) /
+                       distance;
+        }
+        float sign = winding_number(position) > 0.5f ? -1.0f : 1.0f;
+        distances[i] = sign * distance;
+        gradient_x[i] = sign * gradient.x;
+        gradient_y[i] = sign * gradient.y;
+        gradient_z[i] = sign * gradient.z;
+    }
+}
+
+Interval MeshField::evaluate_interval(glm::vec3 box_min, glm::vec3 box_max) const {
+    if (nodes.empty()) {
+        return Interval::unbounded();
+    }
+
+    // Lower bound: distance from the box to the nearest triangle bounds
+    float lower = std::numeric_limits<float>::infinity();
+    std::array<int, stack_depth> stack;
+    int stack_size = 0;
+    stack[stack_size++] = 0;
+    while (stack_size > 0 && lower > 0.0f) {
+        int index = stack[--stack_size];
+        auto &node = nodes[index];
+        if (box_box_squared_distance(box_min, box_max, node.bounds_min, node.bounds_max) >=
+            lower) {
+            continue;
+        }
+        if (node.count == 0) {
+            stack[stack_size++] = index + 1;
+            stack[stack_size++] = node.first;
+            continue;
+        }
+        for (int i = node.first; i < node.first + node.count; ++i) {
+            auto &triangle = triangles[i];
+            lower = std::min(lower, box_box_squared_distance(
+                                        box_min, box_max,
+                                        glm::min(triangle.a, glm::min(triangle.b, triangle.c)),
+                                        glm::max(triangle.a, glm::max(triangle.b, triangle.c))));
+        }
+    }
+    lower = std::sqrt(lower);
+
+    // Upper bound: distance at the center plus the distance to the farthest corner
+    auto center = (box_min + box_max) * 0.5f;
+    float radius = glm::length(box_max - box_min) * 0.5f;
+    int closest = -1;
+    float upper = std::sqrt(squared_distance(center, closest)) + radius;
+    if (lower == 0.0f) {
+        return {-upper, upper};
+    }
+
+    // A closed surface does not cross the box, so the whole box is on the side of its center
+    if (winding_number(center) > 0.5f) {
+        return {-upper, -lower};
+    }
+    return {lower, upper};
+}
@@ -0,0 +1,60 @@
+#pragma once
+
+#include <vector>
+
+#include <glm/glm.hpp>
+
+#include "mesh.hpp"
+#include "sdf_field.hpp"
+
+/** Signed distance to a triangle mesh.
+ * Unsigned distances come from closest-point queries on a bounding-volume hierarchy built
+ * with the surface area heuristic. The sign comes from the generalized winding number, so
+ * small holes and self-intersections are tolerated, evaluated hierarchically with a dipole
+ * approximation for the far nodes of the same hierarchy. Box bounds, used to cull bricks far
+ * from the surface, assume the mesh is closed. */
+class MeshField : public SdfField {
+private:
+    struct Triangle {
+        glm::vec3 a;
+        glm::vec3 b;
+        glm::vec3 c;
+    };
+
+    struct Node {
+        glm::vec3 bounds_min;
+        glm::vec3 bounds_max;
+        int first; // Right child for inner nodes (the left one follows the node), first
+                   // triangle for leaves
+        int count; // Number of triangles in a leaf, 0 for inner nodes
+    };
+
+    /** Far-field expansion of a node for the winding number, kept apart from Node so that
+     * closest-point traversals load two nodes per cache line */
+    struct Dipole {
+        glm::vec3 center;
+        float radius;
+        glm::vec3 area_normal; // Sum of the triangle normals weighted by their areas
+    };
+
+    std::vector<Triangle> triangles; // In leaf order
+    std::vector<Node> nodes;
+    std::vector<Dipole> dipoles;
+
+    int build(std::vector<int> &order, const std::vector<glm::vec3> &centroids,
+              const std::vector<Triangle> &unordered, int first, int count, int depth);
+
+    float squared_distance(glm::vec3 position, int &closest) const;
+    float winding_number(glm::vec3 position) const;
+
+public:
+    MeshField(const Mesh &mesh);
+
+    size_t triangle_count() const;
+    size_t node_count() const;
+
+    void evaluate(PositionSpan positions, float *distances) const override;
+    void evaluate_gradient(PositionSpan positions, float *distances, float *gradient_x,
+                           float *gradient_y, float *gradient_z) const override;
+    Interval evaluate_interval(glm::vec3 box_min, glm::vec3 box_max) const override;
+};
@@ -0,0 +1,27 @@
+#pragma once
+
+#include <cstdint>
+
+#if defined(__BMI2__)
+#include <immintrin.h>
+#endif
+
+// Morton (Z-curve) order of 3D coordinates of up to 10 bits each: the bits of x, y and z are
+// interleaved, x in the lowest bit, so that samples close in space stay close in memory.
+// With BMI2 a coordinate is spread by a single pdep, otherwise by shifts and masks. The
+// compiler only targets BMI2 under -march=native, so only builds with ENABLE_NATIVE_SIMD=ON
+// on a host that has it take the pdep path.
+
+/** Bits of a coordinate moved to every third bit */
+#if defined(__BMI2__)
+inline uint32_t morton_spread(uint32_t value) { return _pdep_u32(value, 0x09249249u); }
+#else
+inline uint32_t morton_spread(uint32_t value) {
+    value &= 0x000003ffu;
+    value = (value | (value << 16)) & 0x030000ffu;
+    value = (value | (value << 8)) & 0x0300f00fu;
+    value = (value | (value << 4)) & 0x030c30c3u;
+    value = (value | (value << 2)) & 0x09249249u;
+    return value;
+}
+#endif
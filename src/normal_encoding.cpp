@@ -0,0 +1,146 @@
+#include <algorithm>
+#include <cmath>
+#include <cstdint>
+#include <cstring>
+
+#include "normal_encoding.hpp"
+
+static const char *format_names[] = {"rgb8", "oct_rg8", "oct_rg16", "none"};
+
+const char *normal_format_name(NormalFormat format) {
+    return format_names[static_cast<int>(format)];
+}
+
+bool parse_normal_format(const std::string &name, NormalFormat &format) {
+    for (int i = 0; i < 4; ++i) {
+        if (name == format_names[i]) {
+            format = static_cast<NormalFormat>(i);
+            return true;
+        }
+    }
+    return false;
+}
+
+static const char *layout_names[] = {"split", "interleaved"};
+
+const char *texel_layout_name(TexelLayout layout) {
+    return layout_names[static_cast<int>(layout)];
+}
+
+bool parse_texel_layout(const std::string &name, TexelLayout &layout) {
+    for (int i = 0; i < 2; ++i) {
+        if (name == layout_names[i]) {
+            layout = static_cast<TexelLayout>(i);
+            return true;
+        }
+    }
+    return false;
+}
+
+size_t normal_texel_bytes(NormalFormat format) {
+    switch (format) {
+    case NormalFormat::oct_rg8:
+        return 2;
+    case NormalFormat::oct_rg16:
+        return 4;
+    case NormalFormat::none:
+        return 0;
+    case NormalFormat::rgb8:
+        break;
+    }
+    return 3;
+}
+
+GLenum normal_internal_format(NormalFormat format) {
+    switch (format) {
+    case NormalFormat::oct_rg8:
+        return GL_RG8;
+    case NormalFormat::oct_rg16:
+        return GL_RG16;
+    case NormalFormat::rgb8:
+    case NormalFormat::none:
+        break;
+    }
+    return GL_RGB8;
+}
+
+GLenum normal_pixel_format(NormalFormat format) {
+    return format == NormalFormat::oct_rg8 || format == NormalFormat::oct_rg16 ? GL_RG : GL_RGB;
+}
+
+GLenum normal_pixel_type(NormalFormat format) {
+    return format == NormalFormat::oct_rg16 ? GL_UNSIGNED_SHORT : GL_UNSIGNED_BYTE;
+}
+
+// Sign that is +1 at zero, so that both halves of the fold stay apart
+static glm::vec2 sign_not_zero(glm::vec2 value) {
+    return glm::vec2(value.x >= 0.0f ? 1.0f : -1.0f, value.y >= 0.0f ? 1.0f : -1.0f);
+}
+
+glm::vec2 octahedral_encode(glm::vec3 normal) {
+    float norm = std::abs(normal.x) + std::abs(normal.y) + std::abs(normal.z);
+    if (norm == 0.0f) {
+        return glm::vec2(0.0f);
+    }
+    normal /= norm;
+    glm::vec2 point(normal.x, normal.y);
+    if (normal.z < 0.0f) {
+        // Fold the lower half over the corners of the square
+        point = (1.0f - glm::abs(glm::vec2(point.y, point.x))) * sign_not_zero(point);
+    }
+    return point;
+}
+
+glm::vec3 octahedral_decode(glm::vec2 point) {
+    glm::vec3 normal(point.x, point.y, 1.0f - std::abs(point.x) - std::abs(point.y));
+    float fold = std::max(-normal.z, 0.0f);
+    normal.x += normal.x >= 0.0f ? -fold : fold;
+    normal.y += normal.y >= 0.0f ? -fold : fold;
+    return glm::normalize(normal);
+}
+
+void encode_normal(NormalFormat format, glm::vec3 normal, GLubyte *texel) {
+    switch (format) {
+    case NormalFormat::oct_rg8: {
+        // Rounded to the nearest code, unlike rgb8
+        auto code = glm::floor((octahedral_encode(normal) * 0.5f + 0.5f) * 255.0f + 0.5f);
+        texel[0] = static_cast<GLubyte>(code.x);
+        texel[1] = static_cast<GLubyte>(code.y);
+        break;
+    }
+    case NormalFormat::oct_rg16: {
+        auto code = glm::floor((octahedral_encode(normal) * 0.5f + 0.5f) * 65535.0f + 0.5f);
+        uint16_t components[2] = {static_cast<uint16_t>(code.x), static_cast<uint16_t>(code.y)};
+        std::memcpy(texel, components, sizeof(components));
+        break;
+    }
+    case NormalFormat::rgb8: {
+        // A unit component maps to 256, which does not fit in a byte
+        auto code = glm::min((normal + 1.0f) * 128.0f, 255.0f);
+        texel[0] = static_cast<GLubyte>(code.x);
+        texel[1] = static_cast<GLubyte>(code.y);
+        texel[2] = static_cast<GLubyte>(code.z);
+        break;
+    }
+    case NormalFormat::none:
+        break;
+    }
+}
+
+glm::vec3 decode_normal(NormalFormat format, const GLubyte *texel) {
+    switch (format) {
+    case NormalFormat::oct_rg8:
+        return octahedral_decode(glm::vec2(texel[0], texel[1]) / 255.0f * 2.0f - 1.0f);
+    case NormalFormat::oct_rg16: {
+        uint16_t components[2];
+        std::memcpy(components, texel, sizeof(components));
+        return octahedral_decode(glm::vec2(components[0], components[1]) / 65535.0f * 2.0f -
+                                 1.0f);
+    }
+    case NormalFormat::rgb8:
+        return glm::vec3(texel[0], texel[1], texel[2]) / 128.0f - 1.0f;
+    case NormalFormat::none:
+        break;
+    }
+    return glm::vec3(0.0f);
+}
@@ -0,0 +1,51 @@
+#pragma once
+
+#include <cstddef>
+#include <glad/glad.hpp>
+#include <glm/glm.hpp>
+#include <string>
+
+// Storage of the baked normals. rgb8 keeps one byte per component, (n + 1) * 128 clamped to 255,
+// which drivers usually pad to 4 bytes. The octahedral formats project the unit sphere on the
+// octahedron |x| + |y| + |z| = 1 and unfold its lower half over the square [-1, 1]^2, so two
+// components of 8 or 16 bits spread their precision evenly over all directions. none keeps no
+// normals at all and the shader takes them from the gradient of the distance texture, at the
+// cost of four more fetches per shaded point.
+
+enum class NormalFormat { rgb8, oct_rg8, oct_rg16, none };
+
+/** Name of a format as the tools print and parse it */
+const char *normal_format_name(NormalFormat format);
+
+/** Parse a format name, returning false if there is no such format */
+bool parse_normal_format(const std::string &name, NormalFormat &format);
+
+/** Bytes of one texel of the normal texture on the CPU, 0 for none */
+size_t normal_texel_bytes(NormalFormat format);
+
+/** Internal format, pixel format and pixel type of the normal texture. rgb8 textures baked on
+ * the GPU use GL_RGBA8 instead, since RGB8 cannot be bound to an image unit. */
+GLenum normal_internal_format(NormalFormat format);
+GLenum normal_pixel_format(NormalFormat format);
+GLenum normal_pixel_type(NormalFormat format);
+
+/** Point of the square [-1, 1]^2 of a unit vector, the zero vector mapping to the center */
+glm::vec2 octahedral_encode(glm::vec3 normal);
+
+/** Unit vector of a point of the square [-1, 1]^2 */
+glm::vec3 octahedral_decode(glm::vec2 point);
+
+/** Write the normal_texel_bytes(format) bytes of a unit or zero normal */
+void encode_normal(NormalFormat format, glm::vec3 normal, GLubyte *texel);
+
+/** Normal of a texel. The zero vector of rgb8 reads back as zero, the octahedral formats
+ * always give a unit vector. */
+glm::vec3 decode_normal(NormalFormat format, const GLubyte *texel);
+
+/** Where the normals sit. split keeps them in a texture of their own. interleaved packs the r8
+ * distance code in the alpha of the rgb8 normal, so that one RGBA8 fetch returns both, and
+ * needs those two formats. */
+enum class TexelLayout { split, interleaved };
+
+const char *texel_layout_name(TexelLayout layout);
+bool parse_texel_layout(const std::string &name, TexelLayout &layout);
@@ -0,0 +1,197 @@
+#include <algorithm>
+#include <cmath>
+#include <iostream>
+#include <limits>
+#include <numeric>
+
+#include "point_cloud_field.hpp"
+
+// Leaves hold up to this many points
+static const int bucket_size = 8;
+
+// Nodes are skipped unless they are closer than the k-th candidate by this factor on squared
+// distances, so neighbour distances are within sqrt(approximation) of the exact ones. This
+// bounds the work deep inside large shells of points, where every point is almost as close.
+static const float approximation = 1.21f;
+
+// Depth of the traversal stack, median splits keep the tree balanced
+static const int stack_depth = 64;
+
+// Keeps inverse squared distance weights finite on the samples
+static const float weight_epsilon = 1e-12f;
+
+PointCloudField::PointCloudField(const Mesh &cloud, int nb_neighbours)
+    : nb_neighbours(std::min(std::max(nb_neighbours, 1), max_neighbours)) {
+    if (cloud.normals.size() != cloud.vertices.size()) {
+        std::cerr << "Error: point cloud has " << cloud.vertices.size() << " points but "
+                  << cloud.normals.size() << " normals" << std::endl;
+        abort();
+    }
+    points = cloud.vertices;
+    normals.reserve(cloud.normals.size());
+    for (auto &normal : cloud.normals) {
+        normals.push_back(glm::dot(normal, normal) > 0.0f ? glm::normalize(normal) : normal);
+    }
+    // Build over a permutation, then store the points in leaf order
+    std::vector<int> order(points.size());
+    std::iota(order.begin(), order.end(), 0);
+    if (!order.empty()) {
+        nodes.reserve(4 * order.size() / bucket_size);
+        build(order, 0, static_cast<int>(order.size()));
+    }
+    std::vector<glm::vec3> tree_points(order.size()), tree_normals(order.size());
+    for (size_t i = 0; i < order.size(); ++i) {
+        tree_points[i] = points[order[i]];
+        tree_normals[i] = normals[order[i]];
+    }
+    points = std::move(tree_points);
+    normals = std::move(tree_normals);
+}
+
+int PointCloudField::build(std::vector<int> &order, int first, int count) {
+    glm::vec3 bounds_min(std::numeric_limits<float>::max());
+    glm::vec3 bounds_max(-std::numeric_limits<float>::max());
+    for (int i = first; i < first + count; ++i) {
+        bounds_min = glm::min(bounds_min, points[order[i]]);
+        bounds_max = glm::max(bounds_max, points[order[i]]);
+    }
+
+    int index = static_cast<int>(nodes.size());
+    nodes.push_back({bounds_min, bounds_max, first, count});
+    if (count <= bucket_size) {
+        return index;
+    }
+
+    auto extent = bounds_max - bounds_min;
+    int axis = extent.x > extent.y ? (extent.x > extent.z ? 0 : 2) : (extent.y > extent.z ? 1 : 2);
+    auto begin = order.begin() + first;
+    std::nth_element(begin, begin + count / 2, begin + count,
+                     [&](int a, int b) { return points[a][axis] < points[b][axis]; });
+
+    // The left child is stored right after its parent, the right one after the left subtree
+    build(order, first, count / 2);
+    int right = build(order, first + count / 2, count - count / 2);
+    nodes[index].first = right;
+    nodes[index].count = 0;
+    return index;
+}
+
+size_t PointCloudField::point_count() const { return points.size(); }
+
+size_t PointCloudField::query_count() const { return nb_queries; }
+
+int PointCloudField::nearest(glm::vec3 position, Neighbour *heap) const {
+    // heap is a max-heap of the best candidates so far, its front is the k-th nearest
+    int heap_size = 0;
+    auto worst = [&]() {
+        return heap_size < nb_neighbours ? std::numeric_limits<float>::infinity()
+                                         : heap[0].squared_distance;
+    };
+    auto cell_distance = [&](int index) {
+        auto gap = glm::max(glm::max(nodes[index].bounds_min - position,
+                                     position - nodes[index].bounds_max),
+                            glm::vec3(0.0f));
+        return glm::dot(gap, gap);
+    };
+
+    std::pair<int, float> stack[stack_depth];
+    int stack_size = 0;
+    if (!nodes.empty()) {
+        stack[stack_size++] = {0, cell_distance(0)};
+    }
+    while (stack_size > 0) {
+        auto entry = stack[--stack_size];
+        if (entry.second * approximation >= worst()) {
+            continue;
+        }
+        auto &node = nodes[entry.first];
+        if (node.count > 0) {
+            for (int i = node.first; i < node.first + node.count; ++i) {
+                auto offset = points[i] - position;
+                Neighbour candidate{glm::dot(offset, offset), i};
+                if (heap_size < nb_neighbours) {
+                    heap[heap_size++] = candidate;
+                    std::push_heap(heap, heap + heap_size);
+                } else if (candidate < heap[0]) {
+                    std::pop_heap(heap, heap + heap_size);
+                    heap[heap_size - 1] = candidate;
+                    std::push_heap(heap, heap + heap_size);
+                }
+            }
+            continue;
+        }
+
+        // Push the far child first so that the near one is visited next
+        int left = entry.first + 1, right = node.first;
+        float left_distance = cell_distance(left), right_distance = cell_distance(right);
+        if (left_distance < right_distance) {
+            std::swap(left, right);
+            std::swap(left_distance, right_distance);
+        }
+        stack[stack_size++] = {left, left_distance};
+        stack[stack_size++] = {right, right_distance};
+    }
+    std::sort_heap(heap, heap + heap_size);
+    return heap_size;
+}
+
+float PointCloudField::evaluate_point(glm::vec3 position, glm::vec3 *gradient) const {
+    Neighbour heap[max_neighbours];
+    int count = nearest(position, heap);
+    if (count == 0) {
+        *gradient = glm::vec3(0.0f);
+        return std::numeric_limits<float>::infinity();
+    }
+
+    // Weighted tangent plane distance and normal
+    float weight_sum = 0.0f, plane_distance = 0.0f;
+    glm::vec3 normal(0.0f);
+    for (int i = 0; i < count; ++i) {
+        float weight = 1.0f / (heap[i].squared_distance + weight_epsilon);
+        auto &point_normal = normals[heap[i].index];
+        plane_distance += weight * glm::dot(position - points[heap[i].index], point_normal);
+        normal += weight * point_normal;
+        weight_sum += weight;
+    }
+    plane_distance /= weight_sum;
+    float sign = plane_distance < 0.0f ? -1.0f : 1.0f;
+
+    // Planes only hold over the patch the neighbours cover, the radius of the neighbourhood
+    // around the nearest point. Farther away, such as past the border of an open scan, they
+    // extend forever and the nearest point gives the distance instead.
+    auto &nearest_point = points[heap[0].index];
+    float nearest_distance = std::sqrt(heap[0].squared_distance);
+    float radius = 0.0f;
+    for (int i = 1; i < count; ++i) {
+        radius = std::max(radius, glm::distance(points[heap[i].index], nearest_point));
+    }
+    if (nearest_distance > radius) {
+        *gradient = sign * (position - nearest_point) / nearest_distance;
+        return sign * nearest_distance;
+    }
+    *gradient = glm::dot(normal, normal) > 0.0f ? glm::normalize(normal) : normal;
+    return plane_distance;
+}
+
+void PointCloudField::evaluate(PositionSpan positions, float *distances) const {
+    nb_queries += positions.count;
+    glm::vec3 gradient;
+    for (size_t i = 0; i < positions.count; ++i) {
+        distances[i] =
+            evaluate_point(glm::vec3(positions.x[i], positions.y[i], positions.z[i]), &gradient);
+    }
+}
+
+void PointCloudField::evaluate_gradient(PositionSpan positions, float *distances,
+                                        float *gradient_x, float *gradient_y,
+                                        float *gradient_z) const {
+    nb_queries += positions.count;
+    for (size_t i = 0; i < positions.count; ++i) {
+        glm::vec3 gradient;
+        distances[i] =
+            evaluate_point(glm::vec3(positions.x[i], positions.y[i], positions.z[i]), &gradient);
+        gradient_x[i] = gradient.x;
+        gradient_y[i] = gradient.y;
+        gradient_z[i] = gradient.z;
+    }
+}
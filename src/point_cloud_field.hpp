@@ -0,0 +1,62 @@
+#pragma once
+
+#include <atomic>
+#include <cstdint>
+#include <vector>
+
+#include <glm/glm.hpp>
+
+#include "mesh.hpp"
+#include "sdf_field.hpp"
+
+/** Signed distance reconstructed from an oriented point cloud.
+ * A k-d tree finds the k nearest points of every query. Their tangent planes, weighted by
+ * inverse squared distance, give the signed distance near the samples. Farther from the
+ * nearest point than the radius of its neighbourhood, the distance to the nearest point takes
+ * over, so the field keeps growing away from the cloud and past the borders of open scans. */
+class PointCloudField : public SdfField {
+private:
+    struct Neighbour {
+        float squared_distance;
+        int index;
+
+        bool operator<(const Neighbour &other) const {
+            return squared_distance < other.squared_distance;
+        }
+    };
+
+    struct Node {
+        glm::vec3 bounds_min;
+        glm::vec3 bounds_max;
+        int first; // Right child for inner nodes (the left one follows the node), first
+                   // point for leaves
+        int count; // Number of points in a leaf, 0 for inner nodes
+    };
+
+    // Points and normals in leaf order. The tree splits at the median along the widest axis,
+    // and keeps the tight bounds of every node, which prune much better than the splitting
+    // planes alone on points lying on a surface.
+    std::vector<glm::vec3> points;
+    std::vector<glm::vec3> normals;
+    std::vector<Node> nodes;
+    int nb_neighbours;
+    mutable std::atomic<size_t> nb_queries{0};
+
+    int build(std::vector<int> &order, int first, int count);
+    int nearest(glm::vec3 position, Neighbour *heap) const;
+    float evaluate_point(glm::vec3 position, glm::vec3 *gradient) const;
+
+public:
+    static constexpr int max_neighbours = 32;
+
+    /** Uses the vertices and normals of the mesh, normals are normalized */
+    PointCloudField(const Mesh &cloud, int nb_neighbours = 8);
+
+    size_t point_count() const;
+    /** Number of k-nearest-neighbour queries answered so far */
+    size_t query_count() const;
+
+    void evaluate(PositionSpan positions, float *distances) const override;
+    void evaluate_gradient(PositionSpan positions, float *distances, float *gradient_x,
+                           float *gradient_y, float *gradient_z) const override;
+};
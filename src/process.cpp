@@ -0,0 +1,67 @@
+#ifdef _WIN32
+#include <process.h>
+#else
+#include <cerrno>
+#include <spawn.h>
+#include <sys/wait.h>
+
+extern char **environ;
+#endif
+
+#include "process.hpp"
+
+#ifdef _WIN32
+// Quote an argument for the command line parser of the C runtime: backslashes are literal
+// except before a quote, where they are doubled and the quote escaped
+static std::string quote_argument(const std::string &argument) {
+    std::string quoted = "\"";
+    size_t nb_backslashes = 0;
+    for (char c : argument) {
+        if (c == '\\') {
+            ++nb_backslashes;
+        } else if (c == '"') {
+            quoted.append(nb_backslashes + 1, '\\');
+            nb_backslashes = 0;
+        } else {
+            nb_backslashes = 0;
+        }
+        quoted += c;
+    }
+    quoted.append(nb_backslashes, '\\');
+    return quoted + "\"";
+}
+#endif
+
+bool run_process(const std::vector<std::string> &command) {
+#ifdef _WIN32
+    // _spawnvp joins the arguments into one command line without quoting them, but starts
+    // the program directly, without cmd.exe expanding anything
+    std::vector<std::string> quoted;
+    for (auto &argument : command) {
+        quoted.push_back(quote_argument(argument));
+    }
+    std::vector<const char *> arguments;
+    for (auto &argument : quoted) {
+        arguments.push_back(argument.c_str());
+    }
+    arguments.push_back(nullptr);
+    return _spawnvp(_P_WAIT, command[0].c_str(), arguments.data()) == 0;
+#else
+    std::vector<char *> arguments;
+    for (auto &argument : command) {
+        arguments.push_back(const_cast<char *>(argument.c_str()));
+    }
+    arguments.push_back(nullptr);
+    pid_t pid;
+    if (posix_spawnp(&pid, arguments[0], nullptr, nullptr, arguments.data(), environ) != 0) {
+        return false;
+    }
+    int status;
+    while (waitpid(pid, &status, 0) < 0) {
+        if (errno != EINTR) {
+            return false;
+        }
+    }
+    return WIFEXITED(status) && WEXITSTATUS(status) == 0;
+#endif
+}
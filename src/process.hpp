@@ -0,0 +1,12 @@
+#pragma once
+
+#include <string>
+#include <vector>
+
+// Child processes started without a shell, so that arguments such as paths reach them as they
+// are and nothing in them is expanded or run.
+
+/** Run command[0], searched in the PATH, with command as its argv and wait for it. Returns
+ * whether it exited successfully. Started with posix_spawnp or, on Windows, _spawnvp with each
+ * argument quoted for the C runtime. */
+bool run_process(const std::vector<std::string> &command);
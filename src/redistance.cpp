@@ -0,0 +1,256 @@
+#include <algorithm>
+#include <cstdint>
+#include <cmath>
+#include <limits>
+#include <vector>
+
+#include "redistance.hpp"
+#include "thread_pool.hpp"
+
+// Side of the tiles swept by one task, a whole number of bricks of the bricked layout
+static const int tile_size = 16;
+
+static const glm::ivec3 axes[3] = {{1, 0, 0}, {0, 1, 0}, {0, 0, 1}};
+
+static bool inside(const DistanceGrid &grid, glm::ivec3 sample) {
+    return glm::all(glm::greaterThanEqual(sample, glm::ivec3(0))) &&
+           glm::all(glm::lessThan(sample, grid.size));
+}
+
+GradientError gradient_error(const DistanceGrid &grid, glm::ivec3 region_min,
+                             glm::ivec3 region_max, float band) {
+    // Central differences need both neighbours
+    region_min = glm::max(region_min, glm::ivec3(1));
+    region_max = glm::min(region_max, grid.size - 1);
+    auto extent = glm::max(region_max - region_min, glm::ivec3(0));
+
+    std::vector<GradientError> slices(extent.z, GradientError{0.0, 0.0f, 0});
+    ThreadPool::global().parallel_for(extent.z, [&](int slice) {
+        int z = region_min.z + slice;
+        auto &error = slices[slice];
+        for (int y = region_min.y; y < region_max.y; ++y) {
+            for (int x = region_min.x; x < region_max.x; ++x) {
+                if (std::abs(grid.at(x, y, z)) >= band) {
+                    continue;
+                }
+                glm::vec3 gradient(grid.at(x + 1, y, z) - grid.at(x - 1, y, z),
+                                   grid.at(x, y + 1, z) - grid.at(x, y - 1, z),
+                                   grid.at(x, y, z + 1) - grid.at(x, y, z - 1));
+                float norm = glm::length(gradient) / (2.0f * grid.voxel_size);
+                float deviation = std::abs(norm - 1.0f);
+                error.mean += deviation;
+                error.max = std::max(error.max, deviation);
+                ++error.nb_samples;
+            }
+        }
+    });
+
+    GradientError total{0.0, 0.0f, 0};
+    for (auto &slice : slices) {
+        total.mean += slice.mean;
+        total.max = std::max(total.max, slice.max);
+        total.nb_samples += slice.nb_samples;
+    }
+    total.mean = total.nb_samples ? total.mean / total.nb_samples : 0.0;
+    return total;
+}
+
+// Distance from a sample next to a sign change to the crossing, each axis giving the crossing
+// by linear interpolation and the axes being combined as for a plane. Infinity when no
+// neighbour has the opposite sign. original gives the value of a sample before redistancing.
+template <typename Original>
+static float interface_distance(const DistanceGrid &grid, const Original &original,
+                                glm::ivec3 sample) {
+    float value = original(sample);
+    if (value == 0.0f) {
+        return 0.0f;
+    }
+    float inverse_sum = 0.0f;
+    for (auto &axis : axes) {
+        float crossing = std::numeric_limits<float>::infinity();
+        for (auto neighbour : {sample - axis, sample + axis}) {
+            if (!inside(grid, neighbour)) {
+                continue;
+            }
+            float neighbour_value = original(neighbour);
+            if ((neighbour_value < 0.0f) != (value < 0.0f)) {
+                crossing = std::min(crossing, value / (value - neighbour_value));
+            }
+        }
+        if (std::isfinite(crossing)) {
+            inverse_sum += 1.0f / std::max(crossing * crossing, 1e-12f);
+        }
+    }
+    return inverse_sum > 0.0f ? grid.voxel_size / std::sqrt(inverse_sum)
+                              : std::numeric_limits<float>::infinity();
+}
+
+// Godunov upwind solution of |grad d| = 1 at a sample from the smallest neighbour along
+// each axis
+static float solve_eikonal(float a, float b, float c, float h) {
+    if (a > b) {
+        std::swap(a, b);
+    }
+    if (b > c) {
+        std::swap(b, c);
+    }
+    if (a > b) {
+        std::swap(a, b);
+    }
+    float solution = a + h;
+    if (solution > b) {
+        solution = 0.5f * (a + b + std::sqrt(std::max(2.0f * h * h - (a - b) * (a - b), 0.0f)));
+        if (solution > c) {
+            float sum = a + b + c;
+            float discriminant = sum * sum - 3.0f * (a * a + b * b + c * c - h * h);
+            solution = (sum + std::sqrt(std::max(discriminant, 0.0f))) / 3.0f;
+        }
+    }
+    return solution;
+}
+
+void redistance(DistanceGrid &grid, glm::ivec3 region_min, glm::ivec3 region_max) {
+    region_min = glm::max(region_min, glm::ivec3(0));
+    region_max = glm::min(region_max, grid.size);
+    auto extent = region_max - region_min;
+    if (glm::any(glm::lessThanEqual(extent, glm::ivec3(0)))) {
+        return;
+    }
+
+    // The region holds unsigned distances during the sweeps: the crossing distance next to the
+    // interface and infinity elsewhere. Samples around it keep their signed values.
+    std::vector<uint8_t> is_interface(static_cast<size_t>(extent.x) * extent.y * extent.z);
+    auto local_index = [&](glm::ivec3 sample) {
+        auto local = sample - region_min;
+        return (static_cast<size_t>(local.z) * extent.y + local.y) * extent.x + local.x;
+    };
+
+    // Signed values of the region and of the one-sample halo its crossings read, so that an
+    // edit only copies what it redistances
+    auto halo_min = glm::max(region_min - 1, glm::ivec3(0));
+    auto halo_max = glm::min(region_max + 1, grid.size);
+    auto halo_extent = halo_max - halo_min;
+    std::vector<float> original(static_cast<size_t>(halo_extent.x) * halo_extent.y *
+                                halo_extent.z);
+    auto halo_index = [&](glm::ivec3 sample) {
+        auto local = sample - halo_min;
+        return (static_cast<size_t>(local.z) * halo_extent.y + local.y) * halo_extent.x +
+               local.x;
+    };
+    auto original_at = [&](glm::ivec3 sample) { return original[halo_index(sample)]; };
+    ThreadPool::global().parallel_for(halo_extent.z, [&](int slice) {
+        int z = halo_min.z + slice;
+        for (int y = halo_min.y; y < halo_max.y; ++y) {
+            for (int x = halo_min.x; x < halo_max.x; ++x) {
+                original[halo_index(glm::ivec3(x, y, z))] = grid.at(x, y, z);
+            }
+        }
+    });
+
+    ThreadPool::global().parallel_for(extent.z, [&](int slice) {
+        int z = region_min.z + slice;
+        for (int y = region_min.y; y < region_max.y; ++y) {
+            for (int x = region_min.x; x < region_max.x; ++x) {
+                glm::ivec3 sample(x, y, z);
+                float distance = interface_distance(grid, original_at, sample);
+                grid.at(x, y, z) = distance;
+                is_interface[local_index(sample)] = std::isfinite(distance);
+            }
+        }
+    });
+
+    // Sweep tiles instead of single samples: tiles of a diagonal plane are independent, while
+    // samples inside a tile are swept in order and stay cache friendly
+    auto nb_tiles = (extent + tile_size - 1) / tile_size;
+    auto sweep_tile = [&](glm::ivec3 tile, glm::ivec3 step) {
+        auto tile_min = region_min + tile * tile_size;
+        auto tile_max = glm::min(tile_min + tile_size, region_max);
+
+        // Index offsets (see DistanceGrid::offset) of the coordinates of the tile and of one
+        // more on each side, so that a neighbour is found by swapping one offset in either layout
+        size_t offsets[3][tile_size + 2];
+        for (int axis = 0; axis < 3; ++axis) {
+            for (int coordinate = tile_min[axis] - 1; coordinate <= tile_max[axis]; ++coordinate) {
+                bool in_grid = coordinate >= 0 && coordinate < grid.size[axis];
+                offsets[axis][coordinate - tile_min[axis] + 1] =
+                    in_grid ? grid.offset(axis, coordinate) : 0;
+            }
+        }
+        // Smallest magnitude of the two neighbours of a sample along an axis
+        auto neighbours = [&](size_t index, int axis, int coordinate) {
+            const size_t *axis_offsets = offsets[axis] + (coordinate - tile_min[axis] + 1);
+            size_t base = index - axis_offsets[0];
+            float lower = coordinate > 0 ? std::abs(grid.values[base + axis_offsets[-1]])
+                                         : std::numeric_limits<float>::infinity();
+            float upper = coordinate + 1 < grid.size[axis]
+                              ? std::abs(grid.values[base + axis_offsets[1]])
+                              : std::numeric_limits<float>::infinity();
+            return std::min(lower, upper);
+        };
+
+        for (int k = 0; k < tile_max.z - tile_min.z; ++k) {
+            int z = step.z > 0 ? tile_min.z + k : tile_max.z - 1 - k;
+            for (int j = 0; j < tile_max.y - tile_min.y; ++j) {
+                int y = step.y > 0 ? tile_min.y + j : tile_max.y - 1 - j;
+                for (int i = 0; i < tile_max.x - tile_min.x; ++i) {
+                    int x = step.x > 0 ? tile_min.x + i : tile_max.x - 1 - i;
+                    glm::ivec3 sample(x, y, z);
+                    if (is_interface[local_index(sample)]) {
+                        continue;
+                    }
+                    auto index = offsets[0][x - tile_min.x + 1] + offsets[1][y - tile_min.y + 1] +
+                                 offsets[2][z - tile_min.z + 1];
+                    float a = neighbours(index, 0, x);
+                    float b = neighbours(index, 1, y);
+                    float c = neighbours(index, 2, z);
+                    if (std::isfinite(std::min({a, b, c}))) {
+                        grid.values[index] = std::min(grid.values[index],
+                                                      solve_eikonal(a, b, c, grid.voxel_size));
+                    }
+                }
+            }
+        }
+    };
+
+    std::vector<glm::ivec3> plane_tiles;
+    for (int direction = 0; direction < 8; ++direction) {
+        // Sweep from the corner given by the direction bits. Tile (i, j, k), counted from that
+        // corner, only waits for the tiles of the previous diagonal plane i + j + k - 1.
+        glm::ivec3 step((direction & 1) ? -1 : 1, (direction & 2) ? -1 : 1,
+                        (direction & 4) ? -1 : 1);
+        int nb_planes = nb_tiles.x + nb_tiles.y + nb_tiles.z - 2;
+        for (int plane = 0; plane < nb_planes; ++plane) {
+            plane_tiles.clear();
+            for (int k = 0; k < nb_tiles.z; ++k) {
+                for (int j = 0; j < nb_tiles.y; ++j) {
+                    int i = plane - k - j;
+                    if (i < 0 || i >= nb_tiles.x) {
+                        continue;
+                    }
+                    plane_tiles.push_back(
+                        glm::ivec3(step.x > 0 ? i : nb_tiles.x - 1 - i,
+                                   step.y > 0 ? j : nb_tiles.y - 1 - j,
+                                   step.z > 0 ? k : nb_tiles.z - 1 - k));
+                }
+            }
+            ThreadPool::global().parallel_for(static_cast<int>(plane_tiles.size()), [&](int tile) {
+                sweep_tile(plane_tiles[tile], step);
+            });
+        }
+    }
+
+    // Restore the signs
+    ThreadPool::global().parallel_for(extent.z, [&](int slice) {
+        int z = region_min.z + slice;
+        for (int y = region_min.y; y < region_max.y; ++y) {
+            for (int x = region_min.x; x < region_max.x; ++x) {
+                // Samples that no distance reached keep their value
+                auto index = grid.index(x, y, z);
+                float value = original_at(glm::ivec3(x, y, z));
+                float distance = std::isfinite(grid.values[index]) ? grid.values[index]
+                                                                   : std::abs(value);
+                grid.values[index] = value < 0.0f ? -distance : distance;
+            }
+        }
+    });
+}
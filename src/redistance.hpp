@@ -0,0 +1,27 @@
+#pragma once
+
+#include <cstddef>
+
+#include <glm/glm.hpp>
+
+#include "distance_grid.hpp"
+
+/** Deviation of the gradient norm from 1, measured with central differences on the samples
+ * of a region whose distance is below a band */
+struct GradientError {
+    double mean;
+    float max;
+    size_t nb_samples;
+};
+
+GradientError gradient_error(const DistanceGrid &grid, glm::ivec3 region_min,
+                             glm::ivec3 region_max, float band);
+
+/** Turn the samples of the region [region_min, region_max) back into distances to the zero
+ * level set, so that |grad d| = 1 again after blends or voxel edits.
+ * Samples next to a sign change keep the crossing estimated from their neighbours, the others
+ * are recomputed by fast sweeping: eight Gauss-Seidel sweeps solving the eikonal equation with
+ * the Godunov upwind scheme. Within a sweep, the tiles of a diagonal plane do not depend on
+ * each other, so each plane of tiles is split across the thread pool. Samples around the region are
+ * read as boundary values, which lets edits be redistanced incrementally. */
+void redistance(DistanceGrid &grid, glm::ivec3 region_min, glm::ivec3 region_max);
@@ -0,0 +1,126 @@
+#include <algorithm>
+#include <cmath>
+#include <random>
+
+#include "error_analysis.hpp"
+#include "resolution_plan.hpp"
+#include "thread_pool.hpp"
+
+ReconstructionError estimate_reconstruction_error(const SdfField &field, glm::vec3 origin,
+                                                  float block_size, int nb_texels, float band,
+                                                  int nb_probes, unsigned seed,
+                                                  EncodingMode mode, DistanceFormat format) {
+    // voxel_band codes saturate a few texels away from the surface, probes beyond would only
+    // measure the saturation, which grows with the resolution as the band narrows
+    float texel_size = block_size / nb_texels;
+    if (mode == EncodingMode::voxel_band) {
+        band = std::min(band, DistanceEncoding::voxel_band_texels * texel_size);
+    }
+
+    std::mt19937 generator(seed);
+    std::uniform_real_distribution<float> offset(0.0f, block_size);
+    std::vector<float> probe_x(nb_probes), probe_y(nb_probes), probe_z(nb_probes);
+    for (int i = 0; i < nb_probes; ++i) {
+        probe_x[i] = origin.x + offset(generator);
+        probe_y[i] = origin.y + offset(generator);
+        probe_z[i] = origin.z + offset(generator);
+    }
+    std::vector<float> probe_distances(nb_probes);
+    field.evaluate({probe_x.data(), probe_y.data(), probe_z.data(), probe_x.size()},
+                   probe_distances.data());
+
+    // Centers of the texels the nearest filter reads at the probes near the surface
+    std::vector<float> exact_distances;
+    std::vector<float> center_x, center_y, center_z;
+    for (int i = 0; i < nb_probes; ++i) {
+        if (std::abs(probe_distances[i]) > band) {
+            continue;
+        }
+        auto texel = nearest_texel(glm::vec3(probe_x[i], probe_y[i], probe_z[i]), origin,
+                                   texel_size, nb_texels);
+        auto center = origin + (glm::vec3(texel) + 0.5f) * texel_size;
+        exact_distances.push_back(probe_distances[i]);
+        center_x.push_back(center.x);
+        center_y.push_back(center.y);
+        center_z.push_back(center.z);
+    }
+    std::vector<float> center_distances(center_x.size());
+    field.evaluate({center_x.data(), center_y.data(), center_z.data(), center_x.size()},
+                   center_distances.data());
+
+    // Compare the stored texel values with the field
+    auto encoding = choose_encoding(mode, field, origin, block_size, nb_texels);
+    ReconstructionError error{0.0f, 0.0f, exact_distances.size()};
+    double error_sum = 0.0;
+    for (size_t i = 0; i < exact_distances.size(); ++i) {
+        float reconstruction = encoding.round_trip(center_distances[i], format);
+        float probe_error = std::abs(reconstruction - exact_distances[i]);
+        error_sum += probe_error;
+        error.max = std::max(error.max, probe_error);
+    }
+    if (error.nb_probes > 0) {
+        error.mean = static_cast<float>(error_sum / error.nb_probes);
+    }
+    return error;
+}
+
+glm::vec3 ResolutionPlan::region_origin(size_t region) const {
+    glm::ivec3 index(region % nb_regions, (region / nb_regions) % nb_regions,
+                     region / (nb_regions * nb_regions));
+    return origin + glm::vec3(index) * region_size;
+}
+
+size_t ResolutionPlan::texture_bytes() const {
+    size_t texel_bytes = distance_texel_bytes(distance_format) + normal_texel_bytes(normal_format);
+    size_t bytes = 0;
+    for (int n : nb_texels) {
+        bytes += texel_bytes * n * n * n;
+    }
+    return bytes;
+}
+
+size_t ResolutionPlan::uniform_bytes() const {
+    size_t texel_bytes = distance_texel_bytes(distance_format) + normal_texel_bytes(normal_format);
+    size_t finest = *std::max_element(nb_texels.begin(), nb_texels.end());
+    return texel_bytes * nb_texels.size() * finest * finest * finest;
+}
+
+ResolutionPlan plan_resolutions(const SdfField &field, glm::vec3 origin, float block_size,
+                                int nb_regions, const std::vector<int> &ladder,
+                                float error_target, float band, int nb_probes,
+                                EncodingMode mode, DistanceFormat distance_format,
+                                NormalFormat normal_format) {
+    ResolutionPlan plan;
+    plan.origin = origin;
+    plan.region_size = block_size / nb_regions;
+    plan.nb_regions = nb_regions;
+    plan.distance_format = distance_format;
+    plan.normal_format = normal_format;
+    size_t nb_total = static_cast<size_t>(nb_regions) * nb_regions * nb_regions;
+    plan.nb_texels.resize(nb_total);
+    plan.errors.resize(nb_total);
+    plan.missed_target.resize(nb_total);
+
+    ThreadPool::global().parallel_for(static_cast<int>(nb_total), [&](int region) {
+        // The same probes at every rung, so that errors only change with the resolution
+        bool met = false;
+        for (int nb_texels : ladder) {
+            auto error =
+                estimate_reconstruction_error(field, plan.region_origin(region), plan.region_size,
+                                              nb_texels, band, nb_probes, region, mode,
+                                              distance_format);
+            met = error.max <= error_target;
+            // Until the target is met, a finer rung only replaces a coarser one if it does
+            // strictly better
+            if (met || nb_texels == ladder.front() || error.max < plan.errors[region].max) {
+                plan.nb_texels[region] = nb_texels;
+                plan.errors[region] = error;
+            }
+            if (met) {
+                break;
+            }
+        }
+        plan.missed_target[region] = !met;
+    });
+    return plan;
+}
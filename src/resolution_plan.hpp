@@ -0,0 +1,70 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <glm/glm.hpp>
+#include <vector>
+
+#include "distance_encoding.hpp"
+#include "normal_encoding.hpp"
+#include "sdf_field.hpp"
+
+// Choice of a resolution per block instead of one nb_texels for the whole volume. The volume
+// is split into regions, each baked as its own Block, and each region takes the coarsest
+// resolution of a ladder whose reconstruction error stays below a target. The error is
+// measured rather than predicted from curvature: at random probes near the surface, the
+// stored value of the texel the nearest filter reads, as the renderer samples the texture, is
+// compared with the field itself. A probe only needs that texel, so the cost does not grow
+// with the resolution.
+
+/** Reconstruction error of a region baked at some resolution, over the probes whose distance
+ * is below the band. Regions without any such probe have no error. */
+struct ReconstructionError {
+    float mean;
+    float max;
+    size_t nb_probes;
+};
+
+/** Error of the block of side block_size at origin baked at nb_texels in format with the
+ * encoding chosen for mode, estimated at nb_probes random probes (seeded by seed). With
+ * voxel_band, the band is narrowed to the distances its codes do not saturate. */
+ReconstructionError estimate_reconstruction_error(const SdfField &field, glm::vec3 origin,
+                                                  float block_size, int nb_texels, float band,
+                                                  int nb_probes, unsigned seed,
+                                                  EncodingMode mode = EncodingMode::fixed,
+                                                  DistanceFormat format = DistanceFormat::r8);
+
+struct ResolutionPlan {
+    glm::vec3 origin;
+    float region_size;
+    int nb_regions;
+    DistanceFormat distance_format;
+    NormalFormat normal_format;
+    /** Per region, x fastest: chosen resolution and its estimated error */
+    std::vector<int> nb_texels;
+    std::vector<ReconstructionError> errors;
+    /** Per region, non-zero if no resolution of the ladder met the target */
+    std::vector<uint8_t> missed_target;
+
+    glm::vec3 region_origin(size_t region) const;
+
+    /** Bytes of the distance and normal textures of all the regions */
+    size_t texture_bytes() const;
+
+    /** Bytes of a uniform grid as fine as the finest region, which is what a single nb_texels
+     * needs to meet the same target everywhere */
+    size_t uniform_bytes() const;
+};
+
+/** Split the block of side block_size at origin into nb_regions^3 regions and give each one
+ * the first resolution of ladder (sorted in increasing order) whose maximum error is at most
+ * error_target. If none is, the region keeps the coarsest resolution with the lowest error and
+ * is flagged in missed_target, since a finer grid cannot beat the quantization of the codes.
+ * Each region chooses its own encoding of mode. The formats are those the regions are baked
+ * in, for the error and the memory. Regions are estimated in parallel. */
+ResolutionPlan plan_resolutions(const SdfField &field, glm::vec3 origin, float block_size,
+                                int nb_regions, const std::vector<int> &ladder,
+                                float error_target, float band, int nb_probes = 1024,
+                                EncodingMode mode = EncodingMode::fixed,
+                                DistanceFormat distance_format = DistanceFormat::r8,
+                                NormalFormat normal_format = NormalFormat::rgb8);
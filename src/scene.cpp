@@ -0,0 +1,96 @@
+#include <algorithm>
+#include <cctype>
+#include <chrono>
+#include <cstdio>
+#include <iostream>
+
+#include "brush_field.hpp"
+#include "csg_jit.hpp"
+#include "csg_program.hpp"
+#include "distance_transform.hpp"
+#include "mesh_field.hpp"
+#include "point_cloud_field.hpp"
+#include "scene.hpp"
+
+bool is_mesh_path(const std::string &path) {
+    auto dot = path.find_last_of('.');
+    if (dot == std::string::npos) {
+        return false;
+    }
+    auto extension = path.substr(dot + 1);
+    std::transform(extension.begin(), extension.end(), extension.begin(),
+                   [](unsigned char c) { return std::tolower(c); });
+    return extension == "obj" || extension == "ply" || extension == "xyz";
+}
+
+// Dimensions of an occupancy volume named <name>_<x>x<y>x<z>.raw
+static bool parse_raw_size(const std::string &path, glm::ivec3 &size) {
+    auto dot = path.find_last_of('.');
+    auto underscore = path.find_last_of('_');
+    if (dot == std::string::npos || path.substr(dot) != ".raw" || underscore == std::string::npos ||
+        underscore > dot) {
+        return false;
+    }
+    auto dimensions = path.substr(underscore + 1, dot - underscore - 1);
+    char separator_x = 0, separator_y = 0;
+    int consumed = 0;
+    if (std::sscanf(dimensions.c_str(), "%d%c%d%c%d%n", &size.x, &separator_x, &size.y,
+                    &separator_y, &size.z, &consumed) != 5 ||
+        consumed != static_cast<int>(dimensions.size()) || separator_x != 'x' ||
+        separator_y != 'x') {
+        return false;
+    }
+    return glm::all(glm::greaterThan(size, glm::ivec3(0)));
+}
+
+// Occupancy volume fitted to the block, centered, and baked from its distance transform
+static std::shared_ptr<const SdfField> load_occupancy_scene(const std::string &path,
+                                                            glm::vec3 block_origin,
+                                                            float block_size) {
+    glm::ivec3 size;
+    if (!parse_raw_size(path, size)) {
+        std::cerr << "Error: occupancy file [" << path
+                  << "] must be named <name>_<x>x<y>x<z>.raw" << std::endl;
+        abort();
+    }
+    float voxel_size = block_size / std::max({size.x, size.y, size.z});
+    auto extent = glm::vec3(size) * voxel_size;
+    auto origin = block_origin + (glm::vec3(block_size) - extent) / 2.0f + voxel_size / 2.0f;
+    auto occupancy = load_occupancy(path, size, origin, voxel_size);
+
+    auto start = std::chrono::steady_clock::now();
+    auto grid = std::make_shared<DistanceGrid>(signed_distance_transform(occupancy));
+    std::chrono::duration<double> duration = std::chrono::steady_clock::now() - start;
+    std::cout << "Distance transform of " << size.x << "x" << size.y << "x" << size.z
+              << " voxels in " << duration.count() << " s" << std::endl;
+    return std::make_shared<GridField>(grid);
+}
+
+std::shared_ptr<const SdfField> load_scene(const std::string &path, glm::vec3 block_origin,
+                                           float block_size, bool compile) {
+    if (path.size() > 8 && path.substr(path.size() - 8) == ".brushes") {
+        return BrushField::load(path);
+    }
+    if (path.size() > 4 && path.substr(path.size() - 4) == ".raw") {
+        return load_occupancy_scene(path, block_origin, block_size);
+    }
+    if (is_mesh_path(path)) {
+        auto mesh = Mesh::load(path);
+        mesh.fit_to_box(block_origin, block_origin + block_size, 0.8f);
+        if (!mesh.triangles.empty()) {
+            return std::make_shared<MeshField>(mesh);
+        }
+        // Oriented point cloud
+        auto start = std::chrono::steady_clock::now();
+        auto point_cloud = std::make_shared<PointCloudField>(mesh);
+        std::chrono::duration<double> duration = std::chrono::steady_clock::now() - start;
+        std::cout << "Indexed " << point_cloud->point_count() << " points ("
+                  << point_cloud->point_count() / duration.count() << " points/s)" << std::endl;
+        return point_cloud;
+    }
+    auto program = CsgProgram::load(path);
+    if (compile) {
+        return compile_program(program);
+    }
+    return std::make_shared<ProgramField>(program);
+}
@@ -0,0 +1,19 @@
+#pragma once
+
+#include <glm/glm.hpp>
+#include <memory>
+#include <string>
+
+#include "sdf_field.hpp"
+
+/** Whether the scene file is a triangle mesh or an oriented point cloud */
+bool is_mesh_path(const std::string &path);
+
+/** Field of the scene file at path, for the block of side block_size at block_origin: a brush
+ * list (.brushes), a triangle mesh or oriented point cloud (.obj, .ply, .xyz) scaled to fit
+ * the block, an occupancy volume (<name>_<x>x<y>x<z>.raw, one byte per voxel, x fastest,
+ * non-zero inside) scaled to fit the block and baked from its signed distance transform, or a
+ * CSG program otherwise, compiled to native code when compile is set.
+ * Prints an error and aborts if the file cannot be loaded. */
+std::shared_ptr<const SdfField> load_scene(const std::string &path, glm::vec3 block_origin,
+                                           float block_size, bool compile);
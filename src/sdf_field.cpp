@@ -0,0 +1,65 @@
+#include <algorithm>
+#include <array>
+#include <vector>
+
+#include "sdf_field.hpp"
+
+float SdfField::distance(glm::vec3 position) const {
+    float result;
+    evaluate({&position.x, &position.y, &position.z, 1}, &result);
+    return result;
+}
+
+static const std::array<glm::vec3, 4> directions = {
+    glm::vec3(1.0f, -1.0f, -1.0f), glm::vec3(-1.0f, -1.0f, 1.0f), glm::vec3(-1.0f, 1.0f, -1.0f),
+    glm::vec3(1.0f, 1.0f, 1.0f)};
+static const float h = 0.0001;
+
+void SdfField::evaluate_gradient(PositionSpan positions, float *distances, float *gradient_x,
+                                 float *gradient_y, float *gradient_z) const {
+    evaluate(positions, distances);
+
+    std::vector<float> probe_x(positions.count), probe_y(positions.count),
+        probe_z(positions.count), probe_distances(positions.count);
+    std::fill(gradient_x, gradient_x + positions.count, 0.0f);
+    std::fill(gradient_y, gradient_y + positions.count, 0.0f);
+    std::fill(gradient_z, gradient_z + positions.count, 0.0f);
+    for (auto &direction : directions) {
+        for (size_t i = 0; i < positions.count; ++i) {
+            probe_x[i] = positions.x[i] + direction.x * h;
+            probe_y[i] = positions.y[i] + direction.y * h;
+            probe_z[i] = positions.z[i] + direction.z * h;
+        }
+        evaluate({probe_x.data(), probe_y.data(), probe_z.data(), positions.count},
+                 probe_distances.data());
+        for (size_t i = 0; i < positions.count; ++i) {
+            gradient_x[i] += direction.x * probe_distances[i];
+            gradient_y[i] += direction.y * probe_distances[i];
+            gradient_z[i] += direction.z * probe_distances[i];
+        }
+    }
+
+    // The probes sum up to 4h times the gradient
+    for (size_t i = 0; i < positions.count; ++i) {
+        gradient_x[i] /= 4.0f * h;
+        gradient_y[i] /= 4.0f * h;
+        gradient_z[i] /= 4.0f * h;
+    }
+}
+
+Interval SdfField::evaluate_interval(glm::vec3, glm::vec3) const { return Interval::unbounded(); }
+
+std::shared_ptr<const SdfField> SdfField::restrict_to(glm::vec3, glm::vec3, float) const {
+    return nullptr;
+}
+
+FunctionField::FunctionField(float (*sdf)(glm::vec3)) { this->sdf = sdf; }
+
+void FunctionField::evaluate(PositionSpan positions, float *distances) const {
+    for (size_t i = 0; i < positions.count; ++i) {
+        distances[i] = sdf(glm::vec3(positions.x[i], positions.y[i], positions.z[i]));
+    }
+}
+
+SphereField::SphereField(glm::vec3 center, float radius)
+    : KernelField<SphereKernel>({center, radius}) {}
@@ -0,0 +1,101 @@
+#pragma once
+
+#include <cmath>
+#include <cstddef>
+#include <glm/glm.hpp>
+#include <memory>
+
+#include "dual.hpp"
+#include "interval.hpp"
+#include "simd.hpp"
+
+/** Structure-of-arrays view over a batch of positions */
+struct PositionSpan {
+    const float *x;
+    const float *y;
+    const float *z;
+    size_t count;
+};
+
+/** Signed distance field evaluated over batches of points.
+ * Implementations write positions.count distances to the output array. */
+class SdfField {
+public:
+    virtual ~SdfField() = default;
+    virtual void evaluate(PositionSpan positions, float *distances) const = 0;
+
+    /** Distances and their gradients in one pass. The default falls back to tetrahedral
+     * finite differences, which costs four extra evaluations per point. */
+    virtual void evaluate_gradient(PositionSpan positions, float *distances, float *gradient_x,
+                                   float *gradient_y, float *gradient_z) const;
+
+    /** Bounds of the field over the box [box_min, box_max]. The default cannot bound
+     * anything and returns an unbounded interval. */
+    virtual Interval evaluate_interval(glm::vec3 box_min, glm::vec3 box_max) const;
+
+    /** Cheaper field that gives the same distances inside [box_min, box_max] wherever they are
+     * below reach, and distances above reach elsewhere, so that the codes of an encoding
+     * saturating at reach do not change. nullptr when the field cannot be simplified (the
+     * default). */
+    virtual std::shared_ptr<const SdfField> restrict_to(glm::vec3 box_min, glm::vec3 box_max,
+                                                        float reach) const;
+
+    /** Convenience single point evaluation */
+    float distance(glm::vec3 position) const;
+};
+
+/** SdfField built from a functor whose call operator is templated on the scalar type.
+ * Distances run on FloatBatch lanes, gradients on Dual<FloatBatch> so that they cost a
+ * single evaluation, and box bounds on Interval. */
+template <typename Kernel> class KernelField : public SdfField {
+protected:
+    Kernel kernel;
+
+public:
+    KernelField(Kernel kernel) : kernel(kernel) {}
+
+    void evaluate(PositionSpan positions, float *distances) const override {
+        for_each_batch(positions.x, positions.y, positions.z, distances, positions.count,
+                       kernel);
+    }
+
+    void evaluate_gradient(PositionSpan positions, float *distances, float *gradient_x,
+                           float *gradient_y, float *gradient_z) const override {
+        for_each_batch_gradient(positions.x, positions.y, positions.z, distances, gradient_x,
+                                gradient_y, gradient_z, positions.count, kernel);
+    }
+
+    Interval evaluate_interval(glm::vec3 box_min, glm::vec3 box_max) const override {
+        return kernel(Interval{box_min.x, box_max.x}, Interval{box_min.y, box_max.y},
+                      Interval{box_min.z, box_max.z});
+    }
+};
+
+/** Adapter for the plain per-point callbacks */
+class FunctionField : public SdfField {
+private:
+    float (*sdf)(glm::vec3);
+
+public:
+    FunctionField(float (*sdf)(glm::vec3));
+    void evaluate(PositionSpan positions, float *distances) const override;
+};
+
+/** Sphere kernel, written once for floats, SIMD batches, dual numbers and intervals */
+struct SphereKernel {
+    glm::vec3 center;
+    float radius;
+
+    template <typename T> T operator()(T x, T y, T z) const {
+        using std::sqrt;
+        auto dx = x - center.x;
+        auto dy = y - center.y;
+        auto dz = z - center.z;
+        return sqrt(dx * dx + dy * dy + dz * dz) - radius;
+    }
+};
+
+class SphereField : public KernelField<SphereKernel> {
+public:
+    SphereField(glm::vec3 center, float radius);
+};
@@ -0,0 +1,72 @@
+#include <algorithm>
+#include <iostream>
+#include <mutex>
+#include <queue>
+#include <thread>
+#include <utility>
+
+#include "process.hpp"
+#include "sharded_bake.hpp"
+
+std::vector<Shard> split_chunks(size_t nb_chunks, int nb_shards) {
+    size_t count = std::min(nb_chunks, static_cast<size_t>(std::max(nb_shards, 1)));
+    std::vector<Shard> shards;
+    for (size_t i = 0; i < count; ++i) {
+        shards.push_back({nb_chunks * i / count, nb_chunks * (i + 1) / count});
+    }
+    return shards;
+}
+
+size_t run_shards(const std::vector<Shard> &shards,
+                  const std::function<WorkerCommand(const Shard &)> &make_command, int nb_workers,
+                  int max_attempts) {
+    // Shards waiting for a worker, with the number of runs they already had
+    std::queue<std::pair<size_t, int>> pending;
+    for (size_t i = 0; i < shards.size(); ++i) {
+        pending.emplace(i, 0);
+    }
+    std::mutex mutex;
+    size_t nb_failed = 0;
+
+    // Each thread only waits on its worker process, the baking happens in the workers
+    auto run_worker = [&]() {
+        while (true) {
+            std::pair<size_t, int> shard;
+            {
+                std::lock_guard<std::mutex> lock(mutex);
+                if (pending.empty()) {
+                    return;
+                }
+                shard = pending.front();
+                pending.pop();
+            }
+            auto &[first_chunk, last_chunk] = shards[shard.first];
+            bool succeeded = run_process(make_command(shards[shard.first]));
+
+            std::lock_guard<std::mutex> lock(mutex);
+            if (succeeded) {
+                continue;
+            }
+            if (++shard.second < max_attempts) {
+                std::cerr << "Warning: worker for chunks [" << first_chunk << ", " << last_chunk
+                          << ") failed, retrying" << std::endl;
+                pending.push(shard);
+            } else {
+                std::cerr << "Error: worker for chunks [" << first_chunk << ", " << last_chunk
+                          << ") failed " << max_attempts << " times" << std::endl;
+                ++nb_failed;
+            }
+        }
+    };
+
+    // A failed shard is queued again by a thread that keeps running, so none is lost even
+    // when the other threads have already returned
+    std::vector<std::thread> threads;
+    for (int i = 0; i < std::max(nb_workers, 1); ++i) {
+        threads.emplace_back(run_worker);
+    }
+    for (auto &thread : threads) {
+        thread.join();
+    }
+    return nb_failed;
+}
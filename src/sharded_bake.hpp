@@ -0,0 +1,31 @@
+#pragma once
+
+#include <cstddef>
+#include <functional>
+#include <string>
+#include <vector>
+
+// Bake of one chunked volume (see chunked_volume.hpp) split across worker processes. A shard
+// is a range of chunks, and shards never overlap. Chunks sit at fixed offsets in the file, so
+// workers write their chunks through their own handles without any locking; the coordinator
+// only hands out shards and restarts the ones whose worker failed.
+
+/** Chunks [first_chunk, last_chunk) of a volume */
+struct Shard {
+    size_t first_chunk;
+    size_t last_chunk;
+};
+
+/** Split nb_chunks chunks into at most nb_shards ranges whose sizes differ by one at most */
+std::vector<Shard> split_chunks(size_t nb_chunks, int nb_shards);
+
+/** Program and arguments of a worker process, as its argv */
+using WorkerCommand = std::vector<std::string>;
+
+/** Run the command make_command(shard) of every shard, at most nb_workers at a time, without
+ * a shell (see process.hpp). Workers take the next shard as soon as they finish, so cheap
+ * shards do not leave processes idle. A shard whose command fails is queued again, up to
+ * max_attempts runs in total. Returns the number of shards that never succeeded. */
+size_t run_shards(const std::vector<Shard> &shards,
+                  const std::function<WorkerCommand(const Shard &)> &make_command, int nb_workers,
+                  int max_attempts);
@@ -0,0 +1,144 @@
+#pragma once
+
+#include <cmath>
+#include <cstddef>
+
+#if defined(__AVX512F__) || defined(__AVX2__)
+#include <immintrin.h>
+#endif
+
+// FloatBatch holds as many floats as the widest vector unit enabled at compile time:
+// 16 lanes with AVX-512, 8 lanes with AVX2 and a single lane otherwise. SDF kernels are
+// written once against this type and its free operators.
+
+#if defined(__AVX512F__)
+
+// The zero-masking forms of sqrt, min and max avoid a spurious -Wuninitialized from GCC 12
+// on the plain intrinsics, and compile to the same instructions
+static constexpr __mmask16 all_lanes = 0xFFFF;
+
+struct FloatBatch {
+    static constexpr int width = 16;
+    __m512 v;
+
+    static FloatBatch load(const float *p) { return {_mm512_loadu_ps(p)}; }
+    static FloatBatch broadcast(float a) { return {_mm512_set1_ps(a)}; }
+    void store(float *p) const { _mm512_storeu_ps(p, v); }
+};
+
+inline FloatBatch operator+(FloatBatch a, FloatBatch b) { return {_mm512_add_ps(a.v, b.v)}; }
+inline FloatBatch operator-(FloatBatch a, FloatBatch b) { return {_mm512_sub_ps(a.v, b.v)}; }
+inline FloatBatch operator*(FloatBatch a, FloatBatch b) { return {_mm512_mul_ps(a.v, b.v)}; }
+inline FloatBatch operator/(FloatBatch a, FloatBatch b) { return {_mm512_div_ps(a.v, b.v)}; }
+inline FloatBatch sqrt(FloatBatch a) { return {_mm512_maskz_sqrt_ps(all_lanes, a.v)}; }
+inline FloatBatch min(FloatBatch a, FloatBatch b) {
+    return {_mm512_maskz_min_ps(all_lanes, a.v, b.v)};
+}
+inline FloatBatch max(FloatBatch a, FloatBatch b) {
+    return {_mm512_maskz_max_ps(all_lanes, a.v, b.v)};
+}
+inline FloatBatch abs(FloatBatch a) { return {_mm512_abs_ps(a.v)}; }
+inline FloatBatch select_less(FloatBatch a, FloatBatch b, FloatBatch if_less,
+                              FloatBatch otherwise) {
+    return {_mm512_mask_blend_ps(_mm512_cmp_ps_mask(a.v, b.v, _CMP_LT_OQ), otherwise.v,
+                                 if_less.v)};
+}
+
+#elif defined(__AVX2__)
+
+struct FloatBatch {
+    static constexpr int width = 8;
+    __m256 v;
+
+    static FloatBatch load(const float *p) { return {_mm256_loadu_ps(p)}; }
+    static FloatBatch broadcast(float a) { return {_mm256_set1_ps(a)}; }
+    void store(float *p) const { _mm256_storeu_ps(p, v); }
+};
+
+inline FloatBatch operator+(FloatBatch a, FloatBatch b) { return {_mm256_add_ps(a.v, b.v)}; }
+inline FloatBatch operator-(FloatBatch a, FloatBatch b) { return {_mm256_sub_ps(a.v, b.v)}; }
+inline FloatBatch operator*(FloatBatch a, FloatBatch b) { return {_mm256_mul_ps(a.v, b.v)}; }
+inline FloatBatch operator/(FloatBatch a, FloatBatch b) { return {_mm256_div_ps(a.v, b.v)}; }
+inline FloatBatch sqrt(FloatBatch a) { return {_mm256_sqrt_ps(a.v)}; }
+inline FloatBatch min(FloatBatch a, FloatBatch b) { return {_mm256_min_ps(a.v, b.v)}; }
+inline FloatBatch max(FloatBatch a, FloatBatch b) { return {_mm256_max_ps(a.v, b.v)}; }
+inline FloatBatch abs(FloatBatch a) {
+    return {_mm256_andnot_ps(_mm256_set1_ps(-0.0f), a.v)};
+}
+inline FloatBatch select_less(FloatBatch a, FloatBatch b, FloatBatch if_less,
+                              FloatBatch otherwise) {
+    return {_mm256_blendv_ps(otherwise.v, if_less.v, _mm256_cmp_ps(a.v, b.v, _CMP_LT_OQ))};
+}
+
+#else
+
+struct FloatBatch {
+    static constexpr int width = 1;
+    float v;
+
+    static FloatBatch load(const float *p) { return {*p}; }
+    static FloatBatch broadcast(float a) { return {a}; }
+    void store(float *p) const { *p = v; }
+};
+
+inline FloatBatch operator+(FloatBatch a, FloatBatch b) { return {a.v + b.v}; }
+inline FloatBatch operator-(FloatBatch a, FloatBatch b) { return {a.v - b.v}; }
+inline FloatBatch operator*(FloatBatch a, FloatBatch b) { return {a.v * b.v}; }
+inline FloatBatch operator/(FloatBatch a, FloatBatch b) { return {a.v / b.v}; }
+inline FloatBatch sqrt(FloatBatch a) { return {std::sqrt(a.v)}; }
+inline FloatBatch min(FloatBatch a, FloatBatch b) { return a.v < b.v ? a : b; }
+inline FloatBatch max(FloatBatch a, FloatBatch b) { return a.v > b.v ? a : b; }
+inline FloatBatch abs(FloatBatch a) { return {std::fabs(a.v)}; }
+inline FloatBatch select_less(FloatBatch a, FloatBatch b, FloatBatch if_less,
+                              FloatBatch otherwise) {
+    return a.v < b.v ? if_less : otherwise;
+}
+
+#endif
+
+inline FloatBatch operator-(FloatBatch a) { return FloatBatch::broadcast(0.0f) - a; }
+
+// Mixed operations with plain floats, so kernels can be written once for float and FloatBatch
+inline FloatBatch operator+(FloatBatch a, float b) { return a + FloatBatch::broadcast(b); }
+inline FloatBatch operator-(FloatBatch a, float b) { return a - FloatBatch::broadcast(b); }
+inline FloatBatch operator*(FloatBatch a, float b) { return a * FloatBatch::broadcast(b); }
+inline FloatBatch operator/(FloatBatch a, float b) { return a / FloatBatch::broadcast(b); }
+inline FloatBatch operator+(float a, FloatBatch b) { return FloatBatch::broadcast(a) + b; }
+inline FloatBatch operator-(float a, FloatBatch b) { return FloatBatch::broadcast(a) - b; }
+inline FloatBatch operator*(float a, FloatBatch b) { return FloatBatch::broadcast(a) * b; }
+inline FloatBatch operator/(float a, FloatBatch b) { return FloatBatch::broadcast(a) / b; }
+
+inline float select_less(float a, float b, float if_less, float otherwise) {
+    return a < b ? if_less : otherwise;
+}
+
+/** Constant of the kernel scalar type */
+template <typename T> T splat(float a) { return T(a); }
+template <> inline FloatBatch splat<FloatBatch>(float a) { return FloatBatch::broadcast(a); }
+
+/** Run kernel(x, y, z) -> FloatBatch over count SoA positions and store the results.
+ * The last partial batch is padded through a small local buffer. */
+template <typename Kernel>
+void for_each_batch(const float *x, const float *y, const float *z, float *out, size_t count,
+                    Kernel kernel) {
+    constexpr size_t width = FloatBatch::width;
+    size_t i = 0;
+    for (; i + width <= count; i += width) {
+        kernel(FloatBatch::load(x + i), FloatBatch::load(y + i), FloatBatch::load(z + i))
+            .store(out + i);
+    }
+    if (i < count) {
+        float tail_x[width] = {}, tail_y[width] = {}, tail_z[width] = {}, tail_out[width];
+        size_t tail = count - i;
+        for (size_t j = 0; j < tail; ++j) {
+            tail_x[j] = x[i + j];
+            tail_y[j] = y[i + j];
+            tail_z[j] = z[i + j];
+        }
+        kernel(FloatBatch::load(tail_x), FloatBatch::load(tail_y), FloatBatch::load(tail_z))
+            .store(tail_out);
+        for (size_t j = 0; j < tail; ++j) {
+            out[i + j] = tail_out[j];
+        }
+    }
+}
@@ -1,18 +1,88 @@
 #include "texture.hpp"
+#include "gl_compute.hpp"
 
-Texture::Texture() : id(0) {}
+Texture::Texture() : id(0), width(0), height(0), texel_bytes(0) {}
 
-Texture::Texture(std::vector<GLubyte> &bytes) { this->bytes = bytes; }
+Texture::Texture(std::vector<GLubyte> bytes)
+    : id(0), bytes(std::move(bytes)), width(0), height(0), texel_bytes(0) {}
+
+Texture::Texture(Texture &&other) noexcept
+    : id(other.id), bytes(std::move(other.bytes)), width(other.width), height(other.height),
+      texel_bytes(other.texel_bytes) {
+    other.id = 0;
+}
+
+Texture &Texture::operator=(Texture &&other) noexcept {
+    if (this != &other) {
+        // The previous texture goes away with its owner
+        if (id) {
+            glDeleteTextures(1, &id);
+        }
+        id = other.id;
+        bytes = std::move(other.bytes);
+        width = other.width;
+        height = other.height;
+        texel_bytes = other.texel_bytes;
+        other.id = 0;
+    }
+    return *this;
+}
+
+// Textures that were never uploaded, as in the tools baking without a GL context, have no id
+// and make no GL call
+Texture::~Texture() {
+    if (id) {
+        glDeleteTextures(1, &id);
+    }
+}
+
+static int components_of(GLenum format) {
+    switch (format) {
+    case GL_RED:
+        return 1;
+    case GL_RG:
+        return 2;
+    case GL_RGB:
+        return 3;
+    default:
+        return 4;
+    }
+}
+
+static size_t component_bytes(GLenum type) {
+    switch (type) {
+    case GL_UNSIGNED_SHORT:
+    case GL_HALF_FLOAT:
+        return 2;
+    case GL_FLOAT:
+        return 4;
+    default:
+        return 1;
+    }
+}
+
+void Texture::send_texture_3D(GLint internalformat, GLsizei width, GLsizei height, GLsizei depth,
+                              GLenum format, GLenum type) {
+    send_texture_3D(internalformat, width, height, depth, format, type, bytes.data());
+}
 
 void Texture::send_texture_3D(GLint internalformat, GLsizei width, GLsizei height, GLsizei depth,
-                              GLenum format) {
-    // Texture genration
+                              GLenum format, GLenum type, const void *pixels) {
+    this->width = width;
+    this->height = height;
+    this->texel_bytes = components_of(format) * component_bytes(type);
+
+    // Texture genration, a second upload replaces the first texture
+    if (id) {
+        glDeleteTextures(1, &id);
+    }
     glGenTextures(1, &id);
     glBindTexture(GL_TEXTURE_3D, id);
 
-    // Send texture to GPU
-    glTexImage3D(GL_TEXTURE_3D, 0, internalformat, width, height, depth, 0, format,
-                 GL_UNSIGNED_BYTE, static_cast<const void *>(bytes.data()));
+    // Send texture to GPU, rows are tightly packed
+    glPixelStorei(GL_UNPACK_ALIGNMENT, 1);
+    glTexImage3D(GL_TEXTURE_3D, 0, internalformat, width, height, depth, 0, format, type,
+                 pixels);
 
     // Mipmap parameters
     glTexParameteri(GL_TEXTURE_3D, GL_TEXTURE_BASE_LEVEL, 0);
@@ -31,9 +101,35 @@ void Texture::send_texture_3D(GLint internalformat, GLsizei width, GLsizei heigh
     glBindTexture(GL_TEXTURE_3D, 0);
 }
 
+void Texture::update_texture_3D(GLint x, GLint y, GLint z, GLsizei box_width,
+                                GLsizei box_height, GLsizei box_depth, GLenum format,
+                                GLenum type) {
+    glBindTexture(GL_TEXTURE_3D, id);
+
+    // Rows and slices of the box are strided by the size of the full volume
+    glPixelStorei(GL_UNPACK_ALIGNMENT, 1);
+    glPixelStorei(GL_UNPACK_ROW_LENGTH, width);
+    glPixelStorei(GL_UNPACK_IMAGE_HEIGHT, height);
+    size_t first_texel = (static_cast<size_t>(z) * height + y) * width + x;
+    glTexSubImage3D(GL_TEXTURE_3D, 0, x, y, z, box_width, box_height, box_depth, format, type,
+                    static_cast<const void *>(bytes.data() + texel_bytes * first_texel));
+    glPixelStorei(GL_UNPACK_ROW_LENGTH, 0);
+    glPixelStorei(GL_UNPACK_IMAGE_HEIGHT, 0);
+
+    glBindTexture(GL_TEXTURE_3D, 0);
+}
+
 void Texture::bind_texture(int index) const {
     glActiveTexture(GL_TEXTURE0 + index);
     glBindTexture(GL_TEXTURE_3D, id);
 }
 
-const GLubyte *Texture::data() const { return bytes.data(); }
\ No newline at end of file
+void Texture::bind_image(GLuint unit, GLenum access, GLenum format) const {
+    glBindImageTexture(unit, id, 0, GL_TRUE, 0, access, format);
+}
+
+const GLubyte *Texture::data() const { return bytes.data(); }
+
+GLubyte *Texture::data() { return bytes.data(); }
+
+bool Texture::has_cpu_copy() const { return !bytes.empty(); }
\ No newline at end of file
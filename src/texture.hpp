@@ -2,16 +2,55 @@
 #include <glad/glad.hpp>
 #include <vector>
 
+/** 3D texture with an optional CPU copy of its texels. The CPU copy is kept as raw bytes, and
+ * the pixel type given on upload (GL_UNSIGNED_BYTE, GL_UNSIGNED_SHORT, GL_HALF_FLOAT or
+ * GL_FLOAT) says how to read them, so one class holds textures of any texel type.
+ * The GL texture is owned: it is deleted with the Texture, which can only be moved. */
 class Texture {
 private:
     GLuint id;
     std::vector<GLubyte> bytes;
+    GLsizei width;
+    GLsizei height;
+    // Bytes of one texel of the CPU copy
+    size_t texel_bytes;
 
 public:
     Texture();
-    Texture(std::vector<GLubyte> &bytes);
+    Texture(std::vector<GLubyte> bytes);
+    Texture(const Texture &) = delete;
+    Texture(Texture &&other) noexcept;
+    Texture &operator=(const Texture &) = delete;
+    Texture &operator=(Texture &&other) noexcept;
+    ~Texture();
+
+    /** Upload the CPU bytes, replacing any previous GL texture */
+    void send_texture_3D(GLint internalformat, GLsizei width, GLsizei height, GLsizei depth,
+                         GLenum format, GLenum type = GL_UNSIGNED_BYTE);
+
+    /** Upload pixels, such as a memory-mapped file, instead of the CPU bytes, or only
+     * allocate the storage if pixels is nullptr. The texture keeps no CPU copy, so
+     * update_texture_3D cannot be used on it. */
     void send_texture_3D(GLint internalformat, GLsizei width, GLsizei height, GLsizei depth,
-                         GLenum format);
+                         GLenum format, GLenum type, const void *pixels);
+
+    /** Upload the box of the CPU bytes starting at texel (x, y, z) into the GPU texture.
+     * The box is read in place from the full volume, nothing is copied. */
+    void update_texture_3D(GLint x, GLint y, GLint z, GLsizei box_width, GLsizei box_height,
+                           GLsizei box_depth, GLenum format, GLenum type = GL_UNSIGNED_BYTE);
     void bind_texture(int index) const;
+
+    /** Bind level 0 of the texture to an image unit, for imageStore in compute shaders.
+     * Needs load_compute_functions (see gl_compute.hpp). */
+    void bind_image(GLuint unit, GLenum access, GLenum format) const;
     const GLubyte *data() const;
+    GLubyte *data();
+
+    /** Whether the texture keeps CPU bytes, which the pixels overload never does */
+    bool has_cpu_copy() const;
+
+    /** CPU texels read as Texel, which must match the pixel type of the upload */
+    template <typename Texel> const Texel *texels() const {
+        return reinterpret_cast<const Texel *>(bytes.data());
+    }
 };
\ No newline at end of file
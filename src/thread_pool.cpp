@@ -0,0 +1,95 @@
+#include <algorithm>
+#include <atomic>
+#include <cstdlib>
+
+#include "thread_pool.hpp"
+
+ThreadPool::ThreadPool(unsigned nb_threads) : stopping{false} {
+    // The calling thread also works during parallel_for, so keep one less worker
+    for (unsigned i = 1; i < nb_threads; ++i) {
+        workers.emplace_back([this]() { worker_loop(); });
+    }
+}
+
+ThreadPool::~ThreadPool() {
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        stopping = true;
+    }
+    condition.notify_all();
+    for (auto &worker : workers) {
+        worker.join();
+    }
+}
+
+unsigned ThreadPool::size() const { return static_cast<unsigned>(workers.size()) + 1; }
+
+void ThreadPool::worker_loop() {
+    while (true) {
+        std::function<void()> task;
+        {
+            std::unique_lock<std::mutex> lock(mutex);
+            condition.wait(lock, [this]() { return stopping || !tasks.empty(); });
+            if (stopping && tasks.empty()) {
+                return;
+            }
+            task = std::move(tasks.front());
+            tasks.pop();
+        }
+        task();
+    }
+}
+
+void ThreadPool::parallel_for(int count, const std::function<void(int)> &task) {
+    if (count <= 0) {
+        return;
+    }
+
+    std::atomic<int> next_index{0};
+    auto run = [&]() {
+        for (int i = next_index++; i < count; i = next_index++) {
+            task(i);
+        }
+    };
+
+    int nb_helpers = std::min(static_cast<int>(workers.size()), count - 1);
+    int remaining_helpers = nb_helpers;
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        for (int i = 0; i < nb_helpers; ++i) {
+            tasks.push([&]() {
+                run();
+                std::lock_guard<std::mutex> lock(mutex);
+                --remaining_helpers;
+                condition.notify_all();
+            });
+        }
+    }
+    condition.notify_all();
+
+    run();
+
+    // Help with queued tasks while waiting, so that a nested parallel_for cannot starve
+    std::unique_lock<std::mutex> lock(mutex);
+    while (remaining_helpers > 0) {
+        if (!tasks.empty()) {
+            auto pending = std::move(tasks.front());
+            tasks.pop();
+            lock.unlock();
+            pending();
+            lock.lock();
+        } else {
+            condition.wait(lock);
+        }
+    }
+}
+
+ThreadPool &ThreadPool::global() {
+    static ThreadPool pool([]() {
+        const char *environment = std::getenv("SDF_THREADS");
+        int nb_threads = environment ? std::atoi(environment) : 0;
+        return nb_threads > 0 ? static_cast<unsigned>(nb_threads)
+                              : std::max(1u, std::thread::hardware_concurrency());
+    }());
+    return pool;
+}
@@ -0,0 +1,38 @@
+#pragma once
+
+#include <condition_variable>
+#include <functional>
+#include <mutex>
+#include <queue>
+#include <thread>
+#include <vector>
+
+/** Fixed set of worker threads used to spread CPU work such as volume baking. */
+class ThreadPool {
+private:
+    std::vector<std::thread> workers;
+    std::queue<std::function<void()>> tasks;
+    std::mutex mutex;
+    std::condition_variable condition;
+    bool stopping;
+
+    void worker_loop();
+
+public:
+    explicit ThreadPool(unsigned nb_threads);
+    ~ThreadPool();
+
+    ThreadPool(const ThreadPool &) = delete;
+    ThreadPool &operator=(const ThreadPool &) = delete;
+
+    /** Number of threads taking part in parallel_for (workers plus the calling thread) */
+    unsigned size() const;
+
+    /** Call task(i) for every i in [0, count) and return once all of them are done.
+     * Indices are handed out one at a time, so uneven items still balance across threads. */
+    void parallel_for(int count, const std::function<void(int)> &task);
+
+    /** Pool shared by the whole program, sized to $SDF_THREADS when set and to the hardware
+     * concurrency otherwise */
+    static ThreadPool &global();
+};
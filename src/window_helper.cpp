@@ -14,12 +14,13 @@ void glfw_init()
 }
 
 
-GLFWwindow* glfw_create_window(int width,int height, const std::string& title)
+GLFWwindow* glfw_create_window(int width,int height, const std::string& title,
+                               int gl_major, int gl_minor)
 {
-    // Indicate to GLFW to setup context compatible with OpenGL 3.3 core profile
+    // Indicate to GLFW to setup context compatible with OpenGL 3.3 core profile (or newer)
     glfwWindowHint(GLFW_CLIENT_API, GLFW_OPENGL_API);
-    glfwWindowHint(GLFW_CONTEXT_VERSION_MAJOR, 3);
-    glfwWindowHint(GLFW_CONTEXT_VERSION_MINOR, 3);
+    glfwWindowHint(GLFW_CONTEXT_VERSION_MAJOR, gl_major);
+    glfwWindowHint(GLFW_CONTEXT_VERSION_MINOR, gl_minor);
     glfwWindowHint(GLFW_OPENGL_FORWARD_COMPAT, 1);
     glfwWindowHint(GLFW_OPENGL_DEBUG_CONTEXT, 1);
     glfwWindowHint(GLFW_OPENGL_PROFILE,GLFW_OPENGL_CORE_PROFILE);
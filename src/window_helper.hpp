@@ -7,8 +7,9 @@
 /** Initialize GLFW (must be called before creating a window) */
 void glfw_init();
 
-/** Create a window using GLFW */
-GLFWwindow* glfw_create_window(int width,int height, const std::string& title);
+/** Create a window using GLFW, with an OpenGL core profile context of the given version */
+GLFWwindow* glfw_create_window(int width,int height, const std::string& title,
+                               int gl_major = 3, int gl_minor = 3);
 
 /** Load OpenGL functions using Glad library */
 void glad_init();
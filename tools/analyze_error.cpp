@@ -0,0 +1,97 @@
+// Bake a scene at several resolutions and distance encodings and measure the error of the
+// decoded volume against the field (see error_analysis.hpp), then print the cheapest setting
+// meeting the tolerances. Distances are decoded with the parameters fragment_shader.glsl gets,
+// and both the nearest filter of the textures and a trilinear filter are measured. Only the
+// nearest filter can be chosen, trilinear is printed for comparison. The block is placed as in
+// the viewer.
+//
+// Usage: analyze-error <scene> [distance tolerance] [normal tolerance in degrees] [band]
+
+#include <cstdlib>
+#include <iomanip>
+#include <iostream>
+#include <memory>
+#include <string>
+
+#include "block.hpp"
+#include "error_analysis.hpp"
+#include "scene.hpp"
+
+// Bake the block with the encoding chosen for mode and decode it
+static DecodedVolume bake_decoded(std::shared_ptr<const SdfField> field, glm::vec3 origin,
+                                  float block_size, int nb_texels, EncodingMode mode) {
+    Block block(origin, block_size, nb_texels, field);
+    block.set_encoding_mode(mode);
+    std::vector<GLubyte> sdf_bytes, normals_bytes;
+    block.bake_bytes(sdf_bytes, normals_bytes);
+    auto encoding = block.distance_encoding();
+    DecodedVolume volume{origin, block_size, nb_texels, {}, {}};
+    for (size_t i = 0; i < sdf_bytes.size(); ++i) {
+        volume.distances.push_back(encoding.decode(sdf_bytes[i]));
+        volume.normals.push_back(decode_normal(
+            block.normal_format(), &normals_bytes[normal_texel_bytes(block.normal_format()) * i]));
+    }
+    return volume;
+}
+
+int main(int argc, char **argv) {
+    if (argc < 2) {
+        std::cerr << "Usage: " << argv[0]
+                  << " <scene> [distance tolerance] [normal tolerance in degrees] [band]"
+                  << std::endl;
+        return EXIT_FAILURE;
+    }
+    float tolerance = argc > 2 ? std::atof(argv[2]) : 0.02f;
+    float normal_tolerance = argc > 3 ? std::atof(argv[3]) : 10.0f;
+
+    glm::vec3 block_origin = glm::vec3(-0.5f, -0.5f, -2.5f);
+    float block_size = 1.0f;
+    float band = argc > 4 ? std::atof(argv[4]) : block_size / 16.0f;
+    auto field = load_scene(argv[1], block_origin, block_size, false);
+
+    std::cout << std::setw(6) << "texels" << std::setw(12) << "encoding" << std::setw(10)
+              << "filter" << std::setw(10) << "MB" << std::setw(12) << "dist rms" << std::setw(12)
+              << "dist max" << std::setw(12) << "normal rms" << std::setw(12) << "normal max"
+              << std::setw(12) << "cross rms" << std::setw(12) << "cross max" << '\n';
+    int best_nb_texels = 0;
+    auto best_mode = EncodingMode::fixed;
+    // Every encoding takes one byte per distance, the order of the modes only breaks ties
+    auto modes = {EncodingMode::fixed, EncodingMode::block_range, EncodingMode::companded,
+                  EncodingMode::voxel_band};
+    for (int nb_texels : {16, 32, 64, 128, 256}) {
+        double megabytes = 4.0 * nb_texels * nb_texels * nb_texels / 1024.0 / 1024.0;
+        for (auto mode : modes) {
+            auto volume = bake_decoded(field, block_origin, block_size, nb_texels, mode);
+            for (auto reconstruction : {Reconstruction::nearest, Reconstruction::trilinear}) {
+                auto report = analyze_volume(*field, volume, reconstruction, band, 100000);
+                std::cout << std::setw(6) << nb_texels << std::setw(12)
+                          << encoding_mode_name(mode) << std::setw(10)
+                          << (reconstruction == Reconstruction::nearest ? "nearest" : "trilinear")
+                          << std::setw(10) << megabytes << std::setw(12) << report.distance_rms
+                          << std::setw(12) << report.distance_max << std::setw(12)
+                          << report.normal_rms << std::setw(12) << report.normal_max
+                          << std::setw(12) << report.crossing_rms << std::setw(12)
+                          << report.crossing_max << '\n';
+                // Sharp edges keep the worst normals and crossings off however fine the grid
+                // is, so those are held to their RMS. Texture sends the volume with GL_NEAREST,
+                // the setting has to be one the viewer renders.
+                bool accepted = reconstruction == Reconstruction::nearest &&
+                                report.distance_max <= tolerance &&
+                                report.crossing_rms <= tolerance &&
+                                report.normal_rms <= normal_tolerance;
+                if (accepted && best_nb_texels == 0) {
+                    best_nb_texels = nb_texels;
+                    best_mode = mode;
+                }
+            }
+        }
+    }
+
+    if (best_nb_texels == 0) {
+        std::cout << "No resolution meets the tolerances with the 8-bit encodings" << std::endl;
+        return EXIT_FAILURE;
+    }
+    std::cout << "Cheapest setting: nb_texels = " << best_nb_texels << ", "
+              << encoding_mode_name(best_mode)
+              << " 8-bit distances, nearest filter, RGB8 normals" << std::endl;
+}
@@ -0,0 +1,131 @@
+// Offline bake of a scene into a chunked volume file (see chunked_volume.hpp), for resolutions
+// whose textures would not fit in memory. The block is placed as in the viewer. With more than
+// one worker, the chunks are split into shards baked by copies of this program started in
+// worker mode (see sharded_bake.hpp).
+//
+// Usage: bake-volume <scene> <output> [nb_texels] [memory budget in MB] [chunk size] [workers]
+//                    [encoding] [distance format] [normal format]
+// Worker mode: bake-volume --worker <scene> <output> <first chunk> <last chunk> <budget in MB>
+// Workers read the distance encoding and the formats from the volume, so all shards share them.
+
+#include <algorithm>
+#include <chrono>
+#include <cstdlib>
+#include <iostream>
+#include <numeric>
+#include <string>
+#include <thread>
+
+#ifndef _WIN32
+#include <sys/resource.h>
+#endif
+
+#include "block.hpp"
+#include "scene.hpp"
+#include "sharded_bake.hpp"
+
+// Bake chunks [first_chunk, last_chunk) of the volume created by the coordinator
+static int run_worker(const std::string &scene_path, const std::string &output_path,
+                      size_t first_chunk, size_t last_chunk, size_t memory_budget) {
+    auto volume = ChunkedVolume::open(output_path);
+    auto field = load_scene(scene_path, volume.origin(), volume.block_size(), false);
+    Block block(volume.origin(), volume.block_size(), volume.nb_texels(), field);
+    std::vector<size_t> chunks(last_chunk - first_chunk);
+    std::iota(chunks.begin(), chunks.end(), first_chunk);
+    block.bake_chunks(volume, chunks, memory_budget);
+    return EXIT_SUCCESS;
+}
+
+int main(int argc, char **argv) {
+    if (argc == 7 && std::string(argv[1]) == "--worker") {
+        return run_worker(argv[2], argv[3], std::atoll(argv[4]), std::atoll(argv[5]),
+                          static_cast<size_t>(std::atoll(argv[6])) << 20);
+    }
+    if (argc < 3) {
+        std::cerr << "Usage: " << argv[0]
+                  << " <scene> <output> [nb_texels] [memory budget in MB] [chunk size] [workers]"
+                     " [encoding] [distance format] [normal format]"
+                  << std::endl;
+        return EXIT_FAILURE;
+    }
+    std::string scene_path = argv[1];
+    std::string output_path = argv[2];
+    int nb_texels = argc > 3 ? std::atoi(argv[3]) : 512;
+    long long budget_mb = argc > 4 ? std::atoll(argv[4]) : 256;
+    int chunk_size = argc > 5 ? std::atoi(argv[5]) : 64;
+    int nb_workers = argc > 6 ? std::atoi(argv[6]) : 1;
+    auto mode = EncodingMode::fixed;
+    if (argc > 7 && !parse_encoding_mode(argv[7], mode)) {
+        std::cerr << "Error: unknown encoding " << argv[7]
+                  << ", expected fixed, voxel_band, block_range or companded" << std::endl;
+        return EXIT_FAILURE;
+    }
+    auto format = DistanceFormat::r8;
+    if (argc > 8 && !parse_distance_format(argv[8], format)) {
+        std::cerr << "Error: unknown distance format " << argv[8]
+                  << ", expected r8, r16, r16f or r32f" << std::endl;
+        return EXIT_FAILURE;
+    }
+    auto normal_format = NormalFormat::rgb8;
+    if (argc > 9 && !parse_normal_format(argv[9], normal_format)) {
+        std::cerr << "Error: unknown normal format " << argv[9]
+                  << ", expected rgb8, oct_rg8, oct_rg16 or none" << std::endl;
+        return EXIT_FAILURE;
+    }
+
+    glm::vec3 block_origin = glm::vec3(-0.5f, -0.5f, -2.5f);
+    float block_size = 1.0f;
+    auto field = load_scene(scene_path, block_origin, block_size, false);
+    auto start = std::chrono::steady_clock::now();
+    if (nb_workers > 1) {
+        auto volume = ChunkedVolume::create(
+            output_path, block_origin, block_size, nb_texels, chunk_size, Block::encoding_version,
+            choose_encoding(mode, *field, block_origin, block_size, nb_texels), format,
+            normal_format);
+        // Several shards per worker balance the load, as most of the cost sits near the
+        // surface. The workers share the cores and the memory budget.
+        auto shards = split_chunks(volume.chunk_count(), 4 * nb_workers);
+        unsigned nb_threads = std::max(1u, std::thread::hardware_concurrency() / nb_workers);
+#ifdef _WIN32
+        _putenv_s("SDF_THREADS", std::to_string(nb_threads).c_str());
+#else
+        setenv("SDF_THREADS", std::to_string(nb_threads).c_str(), 1);
+#endif
+        auto worker_budget = std::to_string(std::max(budget_mb / nb_workers, 1ll));
+        size_t nb_failed = run_shards(
+            shards,
+            [&](const Shard &shard) {
+                return WorkerCommand{argv[0],
+                                     "--worker",
+                                     scene_path,
+                                     output_path,
+                                     std::to_string(shard.first_chunk),
+                                     std::to_string(shard.last_chunk),
+                                     worker_budget};
+            },
+            nb_workers, 3);
+        if (nb_failed > 0) {
+            std::cerr << "Error: " << nb_failed << " shards could not be baked" << std::endl;
+            return EXIT_FAILURE;
+        }
+        std::chrono::duration<double> duration = std::chrono::steady_clock::now() - start;
+        std::cout << "Baked " << shards.size() << " shards with " << nb_workers
+                  << " workers in " << duration.count() << " s" << std::endl;
+        return EXIT_SUCCESS;
+    }
+
+    Block block(block_origin, block_size, nb_texels, field);
+    block.set_encoding_mode(mode);
+    block.set_distance_format(format);
+    block.set_normal_format(normal_format);
+    auto statistics = block.bake_to_file(output_path, chunk_size, budget_mb << 20);
+    std::chrono::duration<double> duration = std::chrono::steady_clock::now() - start;
+    std::cout << "Baked " << statistics.evaluated_texels << " texels, "
+              << statistics.skipped_texels << " skipped for " << statistics.bound_evaluations
+              << " bound evaluations in " << duration.count() << " s" << std::endl;
+#ifndef _WIN32
+    rusage usage;
+    getrusage(RUSAGE_SELF, &usage);
+    std::cout << "Peak resident memory: " << usage.ru_maxrss / 1024 << " MB" << std::endl;
+#endif
+}
@@ -0,0 +1,83 @@
+// Pick a resolution per region of a scene from its measured reconstruction error (see
+// resolution_plan.hpp), and compare the memory of the textures with a uniform grid meeting the
+// same target. The block is placed as in the viewer.
+//
+// Usage: plan-resolution <scene> [error target] [regions per axis] [band] [encoding]
+//                        [distance format] [normal format]
+
+#include <chrono>
+#include <cstdlib>
+#include <iomanip>
+#include <iostream>
+#include <map>
+#include <string>
+
+#include "resolution_plan.hpp"
+#include "scene.hpp"
+
+int main(int argc, char **argv) {
+    if (argc < 2) {
+        std::cerr << "Usage: " << argv[0]
+                  << " <scene> [error target] [regions per axis] [band] [encoding]"
+                     " [distance format] [normal format]"
+                  << std::endl;
+        return EXIT_FAILURE;
+    }
+    auto mode = EncodingMode::fixed;
+    if (argc > 5 && !parse_encoding_mode(argv[5], mode)) {
+        std::cerr << "Error: unknown encoding " << argv[5]
+                  << ", expected fixed, voxel_band, block_range or companded" << std::endl;
+        return EXIT_FAILURE;
+    }
+    auto format = DistanceFormat::r8;
+    if (argc > 6 && !parse_distance_format(argv[6], format)) {
+        std::cerr << "Error: unknown distance format " << argv[6]
+                  << ", expected r8, r16, r16f or r32f" << std::endl;
+        return EXIT_FAILURE;
+    }
+    auto normal_format = NormalFormat::rgb8;
+    if (argc > 7 && !parse_normal_format(argv[7], normal_format)) {
+        std::cerr << "Error: unknown normal format " << argv[7]
+                  << ", expected rgb8, oct_rg8, oct_rg16 or none" << std::endl;
+        return EXIT_FAILURE;
+    }
+    float error_target = argc > 2 ? std::atof(argv[2]) : 0.02f;
+    int nb_regions = argc > 3 ? std::atoi(argv[3]) : 4;
+
+    glm::vec3 block_origin = glm::vec3(-0.5f, -0.5f, -2.5f);
+    float block_size = 1.0f;
+    // Sphere tracing only relies on the distances close to the surface
+    float band = argc > 4 ? std::atof(argv[4]) : block_size / 16.0f;
+    auto field = load_scene(argv[1], block_origin, block_size, false);
+
+    auto start = std::chrono::steady_clock::now();
+    auto plan = plan_resolutions(*field, block_origin, block_size, nb_regions,
+                                 {8, 16, 32, 64, 128, 256}, error_target, band, 1024, mode,
+                                 format, normal_format);
+    std::chrono::duration<double> duration = std::chrono::steady_clock::now() - start;
+
+    std::map<int, int> histogram;
+    float max_error = 0.0f;
+    size_t nb_missed = 0;
+    for (size_t region = 0; region < plan.nb_texels.size(); ++region) {
+        ++histogram[plan.nb_texels[region]];
+        max_error = std::max(max_error, plan.errors[region].max);
+        nb_missed += plan.missed_target[region];
+    }
+    std::cout << "Planned " << plan.nb_texels.size() << " regions in " << duration.count()
+              << " s\n";
+    for (auto &[nb_texels, count] : histogram) {
+        std::cout << std::setw(6) << nb_texels << "^3: " << count << " regions\n";
+    }
+    if (nb_missed > 0) {
+        // The 8-bit codes alone are off by up to half a step, a finer grid cannot help there
+        std::cout << nb_missed
+                  << " regions miss the target at every resolution and keep the coarsest one "
+                     "with the lowest error\n";
+    }
+    std::cout << "Largest estimated error: " << max_error << '\n';
+    std::cout << "Texture memory: " << plan.texture_bytes() / 1024.0 / 1024.0
+              << " MB, uniform grid at the finest resolution: "
+              << plan.uniform_bytes() / 1024.0 / 1024.0 << " MB ("
+              << 100.0 * plan.texture_bytes() / plan.uniform_bytes() << "%)" << std::endl;
+}